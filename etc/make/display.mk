@@ -26,7 +26,7 @@ endif
 ifeq ($(option),enable)
     DEFINES += -D DISPLAY_MODE
     LIBS    += -l ncurses
-    SOURCES += display.c color_cmd.c key_cmd.c map_cmd.c status.c
+    SOURCES += display.c color_cmd.c key_cmd.c map_cmd.c status.c syntax_cmd.c
 else ifeq ($(option),disable)
     SOURCES += stubs.c
 else
@@ -4,6 +4,7 @@
 #
 
 SOURCES = \
+    batch_sys.c    \
     build_str.c    \
     cmd_buf.c      \
     cmd_estack.c   \
@@ -16,13 +17,17 @@ SOURCES = \
     memory.c       \
     option_sys.c   \
     qreg.c         \
+    regex.c        \
+    save_sys.c     \
     search.c       \
+    search_sys.c   \
     teco.c         \
     term_buf.c     \
     term_in.c      \
     term_out.c     \
     term_rubout.c  \
     term_sys.c     \
+    trigram.c      \
                    \
     a_cmd.c        \
     bracket_cmd.c  \
@@ -60,6 +65,7 @@ SOURCES = \
     ff_cmd.c       \
     fk_cmd.c       \
     flag_cmd.c     \
+    fp_cmd.c       \
     fr_cmd.c       \
     g_cmd.c        \
     goto_cmd.c     \
@@ -277,8 +277,8 @@ static const struct cmd_table e_table[] =
     ENTRY('x',         scan_x,          exec_EX,         NO_ARGS),
     ENTRY('Y',         scan_Y,          exec_EY,         NO_ARGS),
     ENTRY('y',         scan_Y,          exec_EY,         NO_ARGS),
-    ENTRY('Z',         scan_ER,         exec_EZ,         NO_ARGS),
-    ENTRY('z',         scan_ER,         exec_EZ,         NO_ARGS),
+    ENTRY('Z',         scan_EZ,         exec_EZ,         NO_ARGS),
+    ENTRY('z',         scan_EZ,         exec_EZ,         NO_ARGS),
     ENTRY('_',         scan_E_ubar,     exec_E_ubar,     NO_ARGS),
 };
 
@@ -296,8 +296,11 @@ static const struct cmd_table f_table[] =
     ENTRY('2',         scan_F1,         exec_F2,         NO_ARGS),
     ENTRY('3',         scan_F1,         exec_F3,         NO_ARGS),
     ENTRY('4',         scan_F1,         exec_F4,         NO_ARGS),
+    ENTRY('5',         scan_F5,         exec_F5,         NO_ARGS),
     ENTRY('<',         NULL,            exec_F_lt,       NO_ARGS),
     ENTRY('>',         NULL,            exec_F_gt,       NO_ARGS),
+    ENTRY('A',         scan_FA,         exec_FA,         NO_ARGS),
+    ENTRY('a',         scan_FA,         exec_FA,         NO_ARGS),
     ENTRY('B',         scan_FB,         exec_FB,         NO_ARGS),
     ENTRY('b',         scan_FB,         exec_FB,         NO_ARGS),
     ENTRY('C',         scan_FC,         exec_FC,         NO_ARGS),
@@ -316,6 +319,8 @@ static const struct cmd_table f_table[] =
     ENTRY('m',         scan_FM,         exec_FM,         NO_ARGS),
     ENTRY('N',         scan_FN,         exec_FN,         NO_ARGS),
     ENTRY('n',         scan_FN,         exec_FN,         NO_ARGS),
+    ENTRY('P',         scan_FP,         exec_FP,         NO_ARGS),
+    ENTRY('p',         scan_FP,         exec_FP,         NO_ARGS),
     ENTRY('Q',         scan_EQ,         exec_FQ,         NO_ARGS),
     ENTRY('q',         scan_EQ,         exec_FQ,         NO_ARGS),
     ENTRY('R',         scan_FR,         exec_FR,         NO_ARGS),
@@ -38,6 +38,8 @@
 
 #define STATUS_HEIGHT        5      ///< Min. height for status window
 
+#define VIEW_MAX             4      ///< Max. no. of edit windows
+
 ///  @struct  tchar
 ///  @brief   Terminal characteristics flag.
 
@@ -74,6 +76,9 @@ struct watch
     union tchar tchar;              ///< 9:W - Terminal characteristics
     int maxline;                    ///< 11:W - Length of longest line in edit buffer
     int status;                     ///< 12:W - Width of status window
+    int redraw;                     ///< 13:W - Min. msecs. between repaints
+    int nviews;                     ///< 14:W - No. of edit windows
+    int view;                       ///< 15:W - Active edit window (less 1)
     int_t botdot;                   ///< Buffer position of bottom right corner
 };
 
@@ -89,6 +94,8 @@ extern bool clear_eol(void);
 
 extern void exit_dpy(void);
 
+extern void exit_syntax(void);
+
 extern int exec_key(int c);
 
 extern bool exec_soft(int key);
@@ -103,6 +110,10 @@ extern void init_dpy(void);
 
 extern void init_keys(void);
 
+extern void mark_column(int_t pos, int_t ndelete, int_t ninsert);
+
+extern void mark_syntax(int_t pos);
+
 extern bool putc_cmd(int c);
 
 extern void refresh_dpy(void);
@@ -113,6 +124,8 @@ extern void reset_dpy(bool all);
 
 extern void rubout_key(int c);
 
+extern void select_view(int view);
+
 extern void set_bits(bool parity);
 
 extern void set_escape(bool escape);
@@ -133,7 +146,8 @@ enum pair
     EDIT,
     STATUS,
     LINE,
-    MAX_PAIR = LINE
+    MAX_PAIR = LINE,
+    SYNTAX                          ///< First pair for syntax styles
 };
 
 ///  @struct  display
@@ -157,8 +171,15 @@ struct display
     int maxcol;                     ///< Max. column for edit window
     int ybias;                      ///< Vertical bias for edit window
     int xbias;                      ///< Horizontal bias for edit window
+    int xpaint;                     ///< Horizontal bias when window painted
+    int crow, ccol;                 ///< Cursor coordinates when window painted
+    bool paint;                     ///< true if edit window needs painting
+    long painted;                   ///< Time window was painted (in msecs.)
     int nrows;                      ///< No. of rows in edit window
     int ncols;                      ///< No. of columns in edit window
+    int_t *rows;                    ///< Buffer position at start of each row
+    int *states;                    ///< Lexer state at start of each row
+    bool syntax;                    ///< true if syntax highlighting enabled
 };
 
 
@@ -169,10 +190,24 @@ extern char keysize[UCHAR_MAX + 1];
 
 extern void check_colors(void);
 
+extern void color_syntax(void);
+
 extern int_t find_column(void);
 
+extern int find_color(const char *token);
+
+extern int_t find_offset(int_t pos, int maxcol);
+
+extern int get_syntax(int_t pos);
+
+extern int_t lex_line(int_t pos, int *state);
+
+extern int_t lex_token(int_t pos, int *state, attr_t *attr);
+
 extern void refresh_status(void);
 
+extern void reset_status(void);
+
 
 #endif
 
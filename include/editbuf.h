@@ -50,6 +50,18 @@ struct edit
     int pos;                    ///< Position in line
 };
 
+///  @struct  dirty
+///
+///  @brief   Range of edit buffer changed since last display update
+
+struct dirty
+{
+    int_t start;                ///< Start of changed text (-1 if none)
+    int_t end;                  ///< End of changed text (in current buffer)
+    int_t delta;                ///< Net change in no. of characters
+    int_t nlines;               ///< Net change in no. of lines
+};
+
 extern const struct edit *t;
 
 // Get no. of lines after dot.
@@ -64,6 +76,14 @@ extern bool append_edit(struct ifile *ifile, uint nlines);
 
 extern int_t before_dot(void);
 
+// Get contiguous block of text containing position.
+
+extern const char *block_edit(int_t pos, int_t *start, int_t *end);
+
+// Convert case of text between two positions.
+
+extern void case_edit(int_t start, int_t end, bool lower);
+
 // Change character at dot.
 
 extern void change_dot(int c);
@@ -72,6 +92,10 @@ extern void change_dot(int c);
 
 extern void delete_edit(int_t nbytes);
 
+// Get range of text changed since last display update.
+
+extern void get_dirty(struct dirty *change);
+
 //  Initialize edit buffer.
 
 extern void init_edit(void);
@@ -105,6 +129,11 @@ extern void move_dot(int_t delta);
 
 extern int read_edit(int_t relpos);
 
+// Replace range of text with new text.
+
+extern bool replace_edit(int_t start, int_t end, const char *buf,
+                         uint_t nbytes);
+
 // Set dot to absolute position.
 
 extern void set_dot(int_t pos);
@@ -113,4 +142,8 @@ extern void set_dot(int_t pos);
 
 extern uint_t size_edit(uint_t size);
 
+// Get contiguous text following dot.
+
+extern const char *span_edit(int_t *nbytes);
+
 #endif  // !defined(_EDITBUF_H)
@@ -78,8 +78,8 @@ union e1_flag
         uint dollar  : 1;       ///< Echo delimiter as ESCape
         uint insert  : 1;       ///< Allow nI w/o ESCape or delimiter
         uint percent : 1;       ///< Allow :%q
-        uint         : 1;       ///< (unused)
-        uint         : 1;       ///< (unused)
+        uint regex   : 1;       ///< Search strings are regular expressions
+        uint trigram : 1;       ///< Index buffer for literal searches
         uint         : 1;       ///< (unused)
         uint repeat  : 1;       ///< Double Ctrl-] repeats command
         uint newline : 1;       ///< LF acts like double ESCape
@@ -126,9 +126,11 @@ union e3_flag
         uint CR_out  : 1;       ///< Convert LF to CR/LF writing output
         uint noin    : 1;       ///< Don't type input to log file
         uint noout   : 1;       ///< Don't type output to log file
-        uint         : 1;       ///< (unused)
+        uint bgsave  : 1;       ///< Save files in background for EC
         uint keepNUL : 1;       ///< Keep NUL chrs. in input files
         uint CR_type : 1;       ///< Convert LF to CR/LF on type out
+        uint datasync: 1;       ///< Flush output file data on close
+        uint fsync   : 1;       ///< Flush output file and directory on close
     };
 };
 
@@ -145,6 +147,7 @@ union e4_flag
         uint invert  : 1;       ///< Put command window above edit window
         uint fence   : 1;       ///< Line between edit and command windows
         uint status  : 1;       ///< Display status on line
+        uint redraw  : 1;       ///< Repaint after every command
     };
 };
 
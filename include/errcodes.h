@@ -102,8 +102,10 @@ enum errcodes
     E_OFO,          ///< Output file already open
     E_PDO,          ///< Push-down list overflow
     E_POP,          ///< Attempt to move pointer off page with 'x'
+    E_RUL,          ///< Invalid syntax rule: 'foo'
     E_SNI,          ///< Semi-colon not in iteration
     E_SRH,          ///< Search failure: 'foo'
+    E_SYS,          ///< System command failed: 'foo'
     E_TAG,          ///< Missing tag: '!foo!'
     E_TXT,          ///< Invalid text delimiter 'x'
     E_UTC,          ///< Unterminated command string
@@ -106,8 +106,10 @@ static struct errlist errlist[] =
     [E_OFO] = { "OFO",  "Output file already open" },
     [E_PDO] = { "PDO",  "Push-down list overflow" },
     [E_POP] = { "POP",  "Attempt to move pointer off page with '%s'" },
+    [E_RUL] = { "RUL",  "Invalid syntax rule: '%s'" },
     [E_SNI] = { "SNI",  "Semi-colon not in iteration" },
     [E_SRH] = { "SRH",  "Search failure: '%s'" },
+    [E_SYS] = { "SYS",  "System command failed: '%s'" },
     [E_TAG] = { "TAG",  "Missing tag: '!%s!'" },
     [E_TXT] = { "TXT",  "Invalid text delimiter '%s'" },
     [E_UTC] = { "UTC",  "Unterminated command string" },
@@ -200,7 +202,9 @@ static const char *errhelp[] =
               "This argument must not be 0.",
     [E_ISS] = "One of the search string special characters "
               "(^Q, ^V, ^W, etc.) would have modified the "
-              "search string delimiter (usually <ESC>).",
+              "search string delimiter (usually <ESC>), or "
+              "the search string is not a valid regular "
+              "expression (when E1&2048 is set).",
     [E_IUC] = "The character following a ^ must have an ASCII "
               "value between 64 and 95 inclusive, or between "
               "141 and 172 inclusive.",
@@ -281,6 +285,10 @@ static const char *errhelp[] =
               "must leave the pointer between 0 and Z, "
               "The characters referenced by a D or nA "
               "command must also be within the buffer limits.",
+    [E_RUL] = "A file of syntax highlighting rules read by an "
+              "F5 command contains an unknown rule, style, "
+              "color, or attribute, or a rule that is missing "
+              "a required argument.",
     [E_SNI] = "A ; command has been executed outside of a "
               "loop.",
     [E_SRH] = "A search command not preceded by a colon "
@@ -294,6 +302,9 @@ static const char *errhelp[] =
               "buffer is cleared. In the case of an N "
               "search it is usually necessary to close "
               "the output file and reopen it.",
+    [E_SYS] = "A system command executed by an FP command "
+              "could not be started, or exited with a non-zero "
+              "status. The edit buffer is unchanged.",
     [E_TAG] = "The tag specified by an O command cannot "
               "be found. This tag must be in the same macro "
               "level as the O command referencing it.",
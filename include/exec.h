@@ -257,12 +257,18 @@ extern bool scan_EQ(struct cmd *cmd);
 
 extern bool scan_ER(struct cmd *cmd);
 
+extern bool scan_EZ(struct cmd *cmd);
+
 extern bool scan_E_ubar(struct cmd *cmd);
 
 extern bool scan_F0(struct cmd *cmd);
 
 extern bool scan_F1(struct cmd *cmd);
 
+extern bool scan_F5(struct cmd *cmd);
+
+extern bool scan_FA(struct cmd *cmd);
+
 extern bool scan_FB(struct cmd *cmd);
 
 extern bool scan_FC(struct cmd *cmd);
@@ -279,6 +285,8 @@ extern bool scan_FM(struct cmd *cmd);
 
 extern bool scan_FN(struct cmd *cmd);
 
+extern bool scan_FP(struct cmd *cmd);
+
 extern bool scan_FR(struct cmd *cmd);
 
 extern bool scan_FS(struct cmd *cmd);
@@ -480,6 +488,10 @@ extern void exec_F3(struct cmd *cmd);
 
 extern void exec_F4(struct cmd *cmd);
 
+extern void exec_F5(struct cmd *cmd);
+
+extern void exec_FA(struct cmd *cmd);
+
 extern void exec_FB(struct cmd *cmd);
 
 extern void exec_FC(struct cmd *cmd);
@@ -496,6 +508,8 @@ extern void exec_FM(struct cmd *cmd);
 
 extern void exec_FN(struct cmd *cmd);
 
+extern void exec_FP(struct cmd *cmd);
+
 extern void exec_FQ(struct cmd *cmd);
 
 extern void exec_FR(struct cmd *cmd);
@@ -65,6 +65,7 @@ struct ofile
     FILE *fp;                       ///< Output file stream
     char *name;                     ///< Output file name
     char *temp;                     ///< Temporary file name
+    bool anon;                      ///< Temporary file has no name
     bool backup;                    ///< File is open for backup
 };
 
@@ -80,6 +81,16 @@ enum otype
     OFILE_MAX                       ///< Maximum output files
 };
 
+///  @enum    save_check
+///  @brief   How to check on a background save.
+
+enum save_check
+{
+    SAVE_PEEK,                      ///< Get state, but don't reap saver
+    SAVE_POLL,                      ///< Reap saver if it has finished
+    SAVE_WAIT                       ///< Wait for saver to finish
+};
+
 // Global variables
 
 extern struct ifile ifiles[];
@@ -94,6 +105,8 @@ extern char last_file[];
 
 // File functions
 
+extern int check_save(enum save_check check);
+
 extern void close_input(uint stream);
 
 extern void close_output(uint stream);
@@ -123,6 +136,8 @@ extern void set_last(const char *name);
 
 extern bool set_wild(const char *filename);
 
+extern bool start_save(void);
+
 extern void write_memory(const char *file);
 
 #endif  // !defined(_FILE_H)
@@ -72,7 +72,9 @@ static const char * const help_text[] =
     "Indirect command file options:",
     "",
     "  -A, --argument         Specify n or m,n arguments for command file.",
+    "  -B, --batch=xyz        Execute macro for each file matching 'xyz'.",
     "  -E, --execute=xyz      Execute TECO macro in file 'xyz'.",
+    "  -J, --jobs=n           Use 'n' worker processes for --batch.",
     "  -T, --text=xyz         Store text 'xyz' in edit buffer.",
     "",
     "Initialization options:",
@@ -104,12 +106,14 @@ static const char * const help_text[] =
 enum option_t
 {
     OPTION_A = 'A',
+    OPTION_B = 'B',
     OPTION_C = 'C',
     OPTION_D = 'D',
     OPTION_E = 'E',
     OPTION_F = 'F',
     OPTION_H = 'H',
     OPTION_I = 'I',
+    OPTION_J = 'J',
     OPTION_L = 'L',
     OPTION_M = 'M',
     OPTION_O = 'O',
@@ -133,7 +137,7 @@ enum option_t
 ///  @var optstring
 ///  String of short options parsed by getopt_long().
 
-static const char * const optstring = ":A:CDE:FHI::L:MO:RS:T:V::Xcfimnorv";
+static const char * const optstring = ":A:B:CDE:FHI::J:L:MO:RS:T:V::Xcfimnorv";
 
 ///  @var    long_options[]
 ///  @brief  Table of command-line options parsed by getopt_long().
@@ -141,12 +145,14 @@ static const char * const optstring = ":A:CDE:FHI::L:MO:RS:T:V::Xcfimnorv";
 static const struct option long_options[] =
 {
     { "argument",       required_argument,  NULL,  'A'    },
+    { "batch",          required_argument,  NULL,  'B'    },
     { "create",         no_argument,        NULL,  'C'    },
     { "display",        no_argument,        NULL,  'D'    },
     { "execute",        required_argument,  NULL,  'E'    },
     { "formfeed",       no_argument,        NULL,  'F'    },
     { "help",           no_argument,        NULL,  'H'    },
     { "initialize",     optional_argument,  NULL,  'I'    },
+    { "jobs",           required_argument,  NULL,  'J'    },
     { "log",            required_argument,  NULL,  'L'    },
     { "memory",         no_argument,        NULL,  'M'    },
     { "output",         required_argument,  NULL,  'O'    },
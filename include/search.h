@@ -57,6 +57,7 @@ struct search
     int_t text_start;                   ///< Start search at this position
     int_t text_end;                     ///< End search at this position
     int_t text_pos;                     ///< Position of string relative to dot
+    int_t match_start;                  ///< Start of matched string
     uint_t match_len;                   ///< No. of characters left to match
     const char *match_buf;              ///< Next character to match
 };
@@ -69,6 +70,28 @@ extern tstring last_search;
 
 extern void build_search(const char *src, uint_t len);
 
+extern int_t count_all(struct search *s, tbuffer *list);
+
+extern bool index_search(struct search *s, bool (*find)(struct search *s));
+
+extern int index_size(void);
+
+extern int index_time(void);
+
+extern void mark_search(int_t pos, int_t ndelete, int_t ninsert);
+
+extern bool regex_backward(struct search *s);
+
+extern bool regex_forward(struct search *s);
+
+extern int_t regex_length(void);
+
+extern int_t replace_all(struct search *s, const char *text, uint_t len);
+
+extern void reset_index(void);
+
+extern void reset_regex(void);
+
 extern bool search_loop(struct search *s);
 
 extern bool search_backward(struct search *s);
@@ -79,4 +102,10 @@ extern bool search_forward(struct search *s);
 
 extern void search_success(struct cmd *cmd);
 
+extern bool split_search(struct search *s, bool (*find)(struct search *s));
+
+extern int split_size(int_t size);
+
+extern int split_workers(int_t n);
+
 #endif  // !defined(_SEARCH_H)
@@ -202,6 +202,9 @@ extern bool check_macro(void);
 
 extern void detach_term(void);
 
+extern const char *exec_batch(const char *pattern, int njobs,
+                              const char *logfile);
+
 extern void exec_options(int argc, const char * const argv[]);
 
 extern void exit_cbuf(void);
@@ -258,7 +261,7 @@ extern void setloop_base(uint base);
 
 extern void *shrink_mem(void *p1, uint_t size, uint_t delta);
 
-extern int teco_env(int n, bool colon);
+extern int teco_env(int n, int_t m, bool m_set, bool colon);
 
 extern int tprint(const char *format, ...);
 
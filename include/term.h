@@ -77,8 +77,14 @@ extern void store_tbuf(int c);
 
 extern bool check_help(void);
 
+extern bool check_typeahead(void);
+
 extern void echo_in(int c);
 
+extern void flush_log(void);
+
+extern void flush_term(void);
+
 extern int getc_term(bool nowait);
 
 extern void init_term(void);
@@ -95,4 +101,6 @@ extern void retype_line(uint_t pos);
 
 extern void type_out(int c);
 
+extern void type_text(const char *text, uint_t len);
+
 #endif  // !defined(_TERM_H)
@@ -0,0 +1,506 @@
+///
+///  @file    batch_sys.c
+///  @brief   System-dependent functions for running batch jobs.
+///
+///  @copyright 2019-2022 Franklin P. Johnston / Nowwith Treble Software
+///
+///  Permission is hereby granted, free of charge, to any person obtaining a
+///  copy of this software and associated documentation files (the "Software"),
+///  to deal in the Software without restriction, including without limitation
+///  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///  and/or sell copies of the Software, and to permit persons to whom the
+///  Software is furnished to do so, subject to the following conditions:
+///
+///  The above copyright notice and this permission notice shall be included in
+///  all copies or substantial portions of the Software.
+///
+///  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIA-
+///  BILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///  THE SOFTWARE.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include "teco.h"
+#include "ascii.h"
+#include "eflags.h"
+#include "errcodes.h"
+#include "exec.h"
+#include "file.h"
+#include "term.h"
+
+
+#define BATCH_SIZE      (KB * 4)        ///< Initial size of output buffer
+
+///  @struct  job
+///  @brief   State of a file being processed by a batch worker.
+
+struct job
+{
+    char *name;                     ///< Name of file
+    pid_t pid;                      ///< Process ID of worker (0 if none)
+    int fd;                         ///< Read end of worker's output pipe
+    tbuffer out;                    ///< Output captured from worker
+    int status;                     ///< Exit status of worker
+    bool done;                      ///< true if worker has finished
+};
+
+
+// Local functions
+
+static void exit_job(void);
+
+static void finish_job(struct job *job);
+
+static uint get_jobs(struct job **jobs);
+
+static void print_batch(FILE *log, const char *format, ...);
+
+static bool read_job(struct job *job);
+
+static bool start_job(struct job *jobs, uint njobs, uint next);
+
+static void write_job(struct job *job, FILE *log);
+
+
+///
+///  @brief    Apply a macro to every file matching a wildcard specification,
+///            using a pool of worker processes. Each worker is a forked copy of
+///            TECO, with its own edit buffer and Q-registers, and its standard
+///            output and error are captured through a pipe. Output for each
+///            file is written in the order in which the files were matched, so
+///            that the results do not depend on which worker finishes first.
+///
+///            The parent process never returns; it exits with EXIT_FAILURE if
+///            any worker failed. Each child process returns the name of the
+///            file it should process.
+///
+///  @returns  Name of file to process (child process only).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+const char *exec_batch(const char *pattern, int nworkers, const char *logfile)
+{
+    assert(pattern != NULL);            // Error if no wildcard specification
+
+    FILE *log = NULL;
+
+    if (logfile != NULL && (log = fopen(logfile, "w")) == NULL)
+    {
+        throw(E_ERR, logfile);          // General error
+    }
+
+    struct job *jobs = NULL;
+    uint njobs = 0;
+
+    if (set_wild(pattern))
+    {
+        njobs = get_jobs(&jobs);
+    }
+
+    if (njobs == 0)
+    {
+        print_batch(log, "?No files match '%s'\n", pattern);
+
+        if (log != NULL)
+        {
+            fclose(log);
+        }
+
+        exit(EXIT_FAILURE);
+    }
+
+    if (nworkers <= 0)
+    {
+        nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+        if (nworkers <= 0)
+        {
+            nworkers = 1;
+        }
+    }
+
+    struct pollfd pfds[nworkers];
+    struct job *active[nworkers];
+    uint next    = 0;                   // Next file to start
+    uint flushed = 0;                   // Next file to write output for
+    uint failed  = 0;                   // No. of failed workers
+    int nactive  = 0;                   // No. of running workers
+
+    while (flushed < njobs)
+    {
+        // Start as many workers as we're allowed to.
+
+        while (nactive < nworkers && next < njobs)
+        {
+            if (start_job(jobs, njobs, next))
+            {
+                return jobs[next].name; // Child process
+            }
+
+            active[nactive++] = &jobs[next++];
+        }
+
+        // Wait for output from any of the running workers.
+
+        for (int i = 0; i < nactive; ++i)
+        {
+            pfds[i].fd      = active[i]->fd;
+            pfds[i].events  = POLLIN;
+            pfds[i].revents = 0;
+        }
+
+        if (nactive != 0 && poll(pfds, (nfds_t)nactive, -1) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            throw(E_ERR, NULL);         // General error
+        }
+
+        for (int i = 0; i < nactive; )
+        {
+            if (pfds[i].revents == 0 || read_job(active[i]))
+            {
+                ++i;
+
+                continue;
+            }
+
+            finish_job(active[i]);
+
+            if (active[i]->status != EXIT_SUCCESS)
+            {
+                ++failed;
+            }
+
+            // Compact the list of running workers.
+
+            --nactive;
+
+            active[i] = active[nactive];
+            pfds[i]   = pfds[nactive];
+        }
+
+        // Write output for all completed files, in order.
+
+        while (flushed < njobs && jobs[flushed].done)
+        {
+            write_job(&jobs[flushed++], log);
+        }
+    }
+
+    if (failed != 0)
+    {
+        print_batch(log, "%%%u of %u file%s failed\n", failed, njobs,
+                    njobs == 1 ? "" : "s");
+    }
+
+    if (log != NULL)
+    {
+        fclose(log);
+    }
+
+    for (uint i = 0; i < njobs; ++i)
+    {
+        free_mem(&jobs[i].name);
+    }
+
+    free_mem(&jobs);
+
+    exit(failed != 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+
+///
+///  @brief    Clean up when worker exits. If the output file is still open,
+///            then the worker exited without completing its EX command (e.g.,
+///            because of an error), so discard the output instead of leaving
+///            a temporary file behind.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void exit_job(void)
+{
+    if (ofiles[OFILE_PRIMARY].fp != NULL)
+    {
+        exec_EK(NULL);
+    }
+}
+
+
+///
+///  @brief    Wait for worker to exit, and save its status.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void finish_job(struct job *job)
+{
+    assert(job != NULL);
+
+    int status;
+
+    close(job->fd);
+
+    job->fd     = -1;
+    job->done   = true;
+    job->status = EXIT_FAILURE;
+
+    while (waitpid(job->pid, &status, 0) == -1)
+    {
+        if (errno != EINTR)
+        {
+            return;
+        }
+    }
+
+    if (WIFEXITED(status))              // Not killed by a signal?
+    {
+        job->status = WEXITSTATUS(status);
+    }
+}
+
+
+///
+///  @brief    Create list of jobs from wildcard matches.
+///
+///  @returns  No. of jobs.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static uint get_jobs(struct job **jobs)
+{
+    assert(jobs != NULL);
+
+    uint size = 16;
+    uint njobs = 0;
+
+    *jobs = alloc_mem((uint_t)(size * sizeof(**jobs)));
+
+    while (get_wild() == EXIT_SUCCESS)
+    {
+        if (njobs == size)
+        {
+            *jobs = expand_mem(*jobs, (uint_t)(size * sizeof(**jobs)),
+                               (uint_t)(size * sizeof(**jobs)));
+            size *= 2;
+        }
+
+        struct job *job = &(*jobs)[njobs++];
+
+        memset(job, 0, sizeof(*job));
+
+        job->name = alloc_mem((uint_t)strlen(last_file) + 1);
+        job->fd   = -1;
+
+        strcpy(job->name, last_file);
+    }
+
+    return njobs;
+}
+
+
+///
+///  @brief    Print message to terminal and to any log file. As for output
+///            from workers, LF is written to the log file as CR/LF.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void print_batch(FILE *log, const char *format, ...)
+{
+    assert(format != NULL);             // Error if no format
+
+    char buf[KB + 1];                   // Allow 1 KB for string
+    va_list args;
+
+    va_start(args, format);
+
+    (void)vsnprintf(buf, sizeof(buf), format, args);
+
+    va_end(args);
+
+    tprint("%s", buf);
+
+    if (log != NULL)
+    {
+        for (const char *p = buf; *p != NUL; ++p)
+        {
+            if (*p == LF)
+            {
+                fputc(CR, log);
+            }
+
+            fputc(*p, log);
+        }
+    }
+}
+
+
+///
+///  @brief    Read pending output from worker.
+///
+///  @returns  true if worker may have more output, false if we hit EOF.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool read_job(struct job *job)
+{
+    assert(job != NULL);
+
+    if (job->out.data == NULL)
+    {
+        job->out = alloc_tbuf(BATCH_SIZE);
+    }
+    else if (job->out.len == job->out.size)
+    {
+        job->out.data = expand_mem(job->out.data, job->out.size,
+                                   job->out.size);
+        job->out.size *= 2;
+    }
+
+    ssize_t nbytes = read(job->fd, job->out.data + job->out.len,
+                          (size_t)(job->out.size - job->out.len));
+
+    if (nbytes > 0)
+    {
+        job->out.len += (uint_t)nbytes;
+
+        return true;
+    }
+    else if (nbytes == -1 && errno == EINTR)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+
+///
+///  @brief    Start worker process for next file. The child's standard input
+///            is redirected from the null device, and its standard output and
+///            error are redirected to a pipe read by the parent.
+///
+///  @returns  true if we are the child process, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool start_job(struct job *jobs, uint njobs, uint next)
+{
+    assert(jobs != NULL);
+
+    struct job *job = &jobs[next];
+    int pipefd[2];
+
+    if (pipe(pipefd) == -1)
+    {
+        throw(E_ERR, job->name);        // General error
+    }
+
+    flush_term();
+    flush_log();
+    fflush(NULL);                       // Don't duplicate any buffered output
+
+    if ((job->pid = fork()) == -1)
+    {
+        throw(E_ERR, job->name);        // General error
+    }
+
+    if (job->pid == 0)                  // Child process
+    {
+        int null = open("/dev/null", O_RDONLY);
+
+        if (null == -1
+            || dup2(null, STDIN_FILENO) == -1
+            || dup2(pipefd[1], STDOUT_FILENO) == -1
+            || dup2(pipefd[1], STDERR_FILENO) == -1)
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        close(null);
+        close(pipefd[0]);
+        close(pipefd[1]);
+
+        // Close our copies of the pipes for any other running workers.
+
+        for (uint i = 0; i < next; ++i)
+        {
+            if (jobs[i].fd != -1)
+            {
+                close(jobs[i].fd);
+            }
+        }
+
+        f.e0.i_redir = true;
+        f.e0.o_redir = true;
+
+        if (atexit(exit_job) != 0)
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        return true;
+    }
+
+    close(pipefd[1]);                   // Parent only reads from pipe
+
+    job->fd = pipefd[0];
+
+    return false;
+}
+
+
+///
+///  @brief    Write output from completed worker to stdout and any log file.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void write_job(struct job *job, FILE *log)
+{
+    assert(job != NULL);
+
+    if (job->out.data != NULL)
+    {
+        flush_term();
+        flush_log();
+        fwrite(job->out.data, 1uL, (size_t)job->out.len, stdout);
+
+        if (log != NULL)
+        {
+            fwrite(job->out.data, 1uL, (size_t)job->out.len, log);
+        }
+
+        free_mem(&job->out.data);
+    }
+
+    if (job->status != EXIT_SUCCESS)
+    {
+        print_batch(log, "%%Processing failed for '%s'\n", job->name);
+    }
+}
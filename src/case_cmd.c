@@ -25,7 +25,6 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -68,7 +67,8 @@ void exec_FU(struct cmd *cmd)
 
 
 ///
-///  @brief    Execute upper or lower case command.
+///  @brief    Execute upper or lower case command. The text is converted in
+///            place, without moving dot.
 ///
 ///  @returns  Nothing.
 ///
@@ -132,34 +132,7 @@ static void exec_case(struct cmd *cmd, bool lower)
         }
     }
 
-    int_t saved_dot = t->dot;
-
-    set_dot(t->dot + m);
-
-    for (int_t i = m; i < n; ++i)
-    {
-        int c = t->c;
-
-        if (c == EOF)
-        {
-            break;
-        }
-
-        if (lower && isupper(c))
-        {
-            change_dot(tolower(c));
-        }
-        else if (!lower && islower(c))
-        {
-            change_dot(toupper(c));
-        }
-        else
-        {
-            set_dot(t->dot + 1);
-        }
-    }
-
-    set_dot(saved_dot);
+    case_edit(dot + m, dot + n, lower);
 }
 
 
@@ -148,6 +148,25 @@ bool scan_F1(struct cmd *cmd)
 }
 
 
+///
+///  @brief    Scan F5 command.
+///
+///  @returns  false (command is not an operand or operator).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool scan_F5(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    reject_m(cmd->m_set);
+    reject_dcolon(cmd->dcolon);
+    scan_texts(cmd, 1, ESC);
+
+    return false;
+}
+
+
 ///
 ///  @brief    Scan FM command.
 ///
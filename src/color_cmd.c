@@ -79,8 +79,6 @@ static const struct color_table system_colors[] =
 
 // Local functions
 
-static int find_color(const char *token);
-
 static void make_pair(short pair);
 
 static void set_color(const tstring *text, short sat, short color, bool type);
@@ -156,6 +154,7 @@ void exec_F1(struct cmd *cmd)
 void exec_F2(struct cmd *cmd)
 {
     set_colors(cmd, EDIT);
+    color_syntax();                     // Syntax colors use edit background
 
     if (f.e0.display)
     {
@@ -207,7 +206,7 @@ void exec_F4(struct cmd *cmd)
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static int find_color(const char *token)
+int find_color(const char *token)
 {
     if (token == NULL)
     {
@@ -270,6 +269,8 @@ void reset_colors(void)
             make_pair(STATUS);
             make_pair(LINE);
         }
+
+        color_syntax();
     }
 }
 
@@ -82,6 +82,8 @@ void exec_ctrl_T(struct cmd *cmd)
 
             f.et.image = saved_image;
         }
+
+        flush_term();                   // Output may not end with a newline
     }
     else                                // ^T -> read character from terminal
     {
@@ -90,6 +92,7 @@ void exec_ctrl_T(struct cmd *cmd)
         if (!f.et.noecho && c != -1)
         {
             type_out(c);
+            flush_term();
         }
 
         push_x((int_t)c, X_OPERAND);
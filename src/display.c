@@ -29,6 +29,7 @@
 #include <ncurses.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #define DISPLAY_INTERNAL            ///< Enable internal definitions
 
@@ -42,6 +43,41 @@
 
 #define MIN_ROWS            10      ///< Minimum no. of rows for edit window
 
+#define COL_STEP          1024      ///< Bytes between column checkpoints
+
+#define COL_INIT            64      ///< Initial no. of column checkpoints
+
+#define COL_LINES           64      ///< No. of lines with column checkpoints
+
+#define VIEW_ROWS            3      ///< Minimum no. of rows for each view
+
+///  @struct  view
+///  @brief   State of an edit window. The state of the active window is kept
+///           in the display and watch structures, so that the same code may
+///           be used for all windows: the state of any other window is
+///           swapped in while that window is painted.
+
+struct view
+{
+    WINDOW *edit;                   ///< Edit window
+    int minrow;                     ///< Min. row for window
+    int maxrow;                     ///< Max. row for window
+    int nrows;                      ///< No. of rows in window
+    int ybias;                      ///< Vertical bias for window
+    int xbias;                      ///< Horizontal bias for window
+    int xpaint;                     ///< Horizontal bias when window painted
+    int_t topdot;                   ///< Buffer position of upper left corner
+    int_t botdot;                   ///< Buffer position of bottom right corner
+    int_t *rows;                    ///< Buffer position at start of each row
+    int *states;                    ///< Lexer state at start of each row
+};
+
+static struct view views[VIEW_MAX]; ///< Edit windows (views)
+
+static WINDOW *lines[VIEW_MAX - 1]; ///< Lines dividing edit windows
+
+static bool repaint = false;        ///< true if active window needs repainting
+
 
 ///
 ///  @var     d
@@ -68,8 +104,81 @@ struct display d =
     .maxcol  = 0,
     .ybias   = 0,
     .xbias   = 0,
+    .xpaint  = 0,
+    .crow    = 0,
+    .ccol    = 0,
+    .paint   = false,
+    .painted = 0,
     .nrows   = 0,
     .ncols   = 0,
+    .rows    = NULL,
+    .states  = NULL,
+    .syntax  = false,
+};
+
+///  @struct  cols
+///  @brief   Column checkpoints for a line. This holds the display column of
+///           every COL_STEP'th character from the start of a scan, so that
+///           converting between offsets and columns on long lines doesn't
+///           need to rescan the entire line. If syntax highlighting is on,
+///           it also holds the lexer state at the first token following
+///           every COL_STEP characters, and at the start of the next line,
+///           so that painting a row doesn't need to lex the entire line.
+
+struct cols
+{
+    int_t start;                    ///< Position where scan started
+    int_t stop;                     ///< Position of first delimiter (or -1)
+    uint_t count;                   ///< No. of checkpoints saved (0 if unused)
+    uint_t size;                    ///< No. of checkpoints allocated
+    int_t *cols;                    ///< Column at each checkpoint
+    uint_t used;                    ///< When checkpoints were last used
+    int state;                      ///< Lexer state at start of line
+    int_t next;                     ///< Start of next line (or -1)
+    int endstate;                   ///< Lexer state at start of next line
+    uint_t nlex;                    ///< No. of lexer checkpoints saved
+    uint_t lexsize;                 ///< No. of lexer checkpoints allocated
+
+    struct
+    {
+        int_t pos;                  ///< Position of token
+        int state;                  ///< Lexer state at token
+    } *lex;                         ///< Lexer checkpoints
+};
+
+///
+///  @var     cc
+///
+///  @brief   Column checkpoints for the lines most recently scanned. Only
+///           lines longer than COL_STEP characters are saved, and a new line
+///           replaces the least recently used one, so that scans of several
+///           long lines (e.g., for each row of a window scrolled
+///           horizontally) don't discard each other.
+///
+
+static struct cols cc[COL_LINES];
+
+static uint_t cc_used = 0;          ///< Counter for least recently used line
+
+///
+///  @var     lc
+///
+///  @brief   Buffer positions of the rows occupied by changed text. These are
+///           found by the first edit window repainted after a change, and are
+///           used by any other windows showing the same text, so that the
+///           text is only laid out once.
+///
+
+static struct
+{
+    uint_t count;                   ///< No. of rows saved
+    uint_t size;                    ///< No. of rows allocated
+    int_t *rows;                    ///< Position at start of each row
+} lc =
+{
+    .count = 0,
+    .size  = 0,
+    .rows  = NULL,
 };
 
 /// @def    check(cond)
@@ -86,16 +195,58 @@ struct display d =
 
 static inline void (check)(bool cond);
 
+static int count_rows(int_t pos, int_t target, int maxrows, int_t *end);
+
+static struct cols *find_cols(int_t start, bool create);
+
+static struct cols *find_lex(int_t start, int state);
+
+static int_t find_pos(int_t start, int_t end, int_t maxcol, bool cr,
+                      int_t *col);
+
+static long get_msecs(void);
+
+static void init_views(int top, int bot);
+
 static void init_window(WINDOW **win, int pair, int top, int bot, int col, int width);
 
 static void init_windows(void);
 
+static int_t lex_end(struct cols *cp, int_t pos, int *state);
+
+static int_t lex_next(struct cols *cp, int_t pos, int *state, attr_t *attr);
+
+static int_t lex_skip(struct cols *cp, int_t next, int_t pos, int *state,
+                      attr_t *attr);
+
+static void move_view(int view);
+
+static int_t next_row(int_t pos);
+
+static int paint_chr(int c, int_t col);
+
+static void paint_dpy(void);
+
+static int_t paint_row(int row, int_t pos);
+
+static void paint_rows(int row, int_t pos);
+
+static void paint_views(const struct dirty *dirty, bool all);
+
 static void refresh_edit(void);
 
+static bool refresh_rows(const struct dirty *dirty);
+
 static void reset_cursor(void);
 
 static void set_cursor(void);
 
+static int_t start_row(int_t pos);
+
+static void swap_view(struct view *view);
+
+static void update_dpy(void);
+
 
 ///
 ///  @brief    Issue an error if caller's function call failed.
@@ -141,6 +292,67 @@ bool clear_eol(void)
 }
 
 
+///
+///  @brief    Count the rows between two buffer positions, up to a maximum.
+///            The rows found are saved, so that they can be reused by other
+///            edit windows that need to count the same rows.
+///
+///  @returns  No. of rows counted.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int count_rows(int_t pos, int_t target, int maxrows, int_t *end)
+{
+    assert(end != NULL);
+
+    if (lc.count == 0 || lc.rows[0] != pos)
+    {
+        lc.count = 0;                   // Different text, so start over
+    }
+
+    int nrows = 0;
+
+    while (true)
+    {
+        if ((uint_t)nrows == lc.count)  // Save row if we just found it
+        {
+            if (lc.rows == NULL)
+            {
+                lc.size = (uint_t)d.nrows + 1;
+                lc.rows = alloc_mem((uint_t)sizeof(*lc.rows) * lc.size);
+            }
+            else if (lc.count == lc.size)
+            {
+                uint_t size = (uint_t)sizeof(*lc.rows) * lc.size;
+
+                lc.rows  = expand_mem(lc.rows, size, size);
+                lc.size *= 2;
+            }
+
+            lc.rows[lc.count++] = pos;
+        }
+
+        if (pos == target || pos == -1 || nrows == maxrows)
+        {
+            break;
+        }
+
+        if ((uint_t)++nrows < lc.count)
+        {
+            pos = lc.rows[nrows];
+        }
+        else
+        {
+            pos = next_row(pos);
+        }
+    }
+
+    *end = pos;
+
+    return nrows;
+}
+
+
 ///
 ///  @brief    Exit display mode.
 ///
@@ -154,6 +366,29 @@ void exit_dpy(void)
     {
         f.e0.display = false;
 
+        free_mem(&d.rows);
+        free_mem(&d.states);
+        free_mem(&lc.rows);
+
+        for (int i = 0; i < COL_LINES; ++i)
+        {
+            free_mem(&cc[i].cols);
+            free_mem(&cc[i].lex);
+
+            cc[i].count   = 0;
+            cc[i].size    = 0;
+            cc[i].lexsize = 0;
+        }
+
+        lc.count = 0;
+        lc.size  = 0;
+
+        for (int i = 0; i < VIEW_MAX; ++i)
+        {
+            free_mem(&views[i].rows);
+            free_mem(&views[i].states);
+        }
+
         endwin();
         init_term();
     }
@@ -163,44 +398,262 @@ void exit_dpy(void)
 ///
 ///  @brief    Find the column required for the current 'dot'.
 ///
-///  @returns  No. of bytes to adjust 'dot'.
+///  @returns  Column no.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
 int_t find_column(void)
 {
-    int_t pos = -t->pos;                // Get no. of chrs. to start of line
-    int col = 0;                        // Current column in line
-    int c;
+    int_t col;
+
+    (void)find_pos(t->dot - t->pos, t->dot, (int_t)-1, (bool)false, &col);
+
+    return col;
+}
+
+
+///
+///  @brief    Find the column checkpoints for a line. If we have none, and the
+///            caller wants to save some, then replace the least recently used
+///            line.
+///
+///  @returns  Column checkpoints (or NULL if none found or created).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static struct cols *find_cols(int_t start, bool create)
+{
+    struct cols *lru = &cc[0];
+
+    for (int i = 0; i < COL_LINES; ++i)
+    {
+        if (cc[i].count != 0 && cc[i].start == start)
+        {
+            cc[i].used = ++cc_used;
+
+            return &cc[i];
+        }
+        else if (lru->count != 0
+                 && (cc[i].count == 0 || cc[i].used < lru->used))
+        {
+            lru = &cc[i];               // Prefer unused lines
+        }
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+
+    if (lru->cols == NULL)
+    {
+        lru->size = COL_INIT;
+        lru->cols = alloc_mem((uint_t)sizeof(*lru->cols) * lru->size);
+    }
+
+    lru->start   = start;
+    lru->stop    = -1;
+    lru->count   = 1;
+    lru->cols[0] = 0;
+    lru->used    = ++cc_used;
+    lru->next    = -1;
+    lru->nlex    = 0;
+
+    return lru;
+}
+
+
+///
+///  @brief    Find the lexer checkpoints for a line that starts in a given
+///            state, if the line is long enough to need them. Any checkpoints
+///            saved for a different starting state are discarded.
+///
+///  @returns  Checkpoints for line (or NULL if line is short).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static struct cols *find_lex(int_t start, int state)
+{
+    struct cols *cp = find_cols(start, (bool)false);
+
+    if (cp == NULL)
+    {
+        if (next_row(start) - start <= COL_STEP)
+        {
+            return NULL;                // Short line, so no need to save
+        }
+
+        cp = find_cols(start, (bool)true);
+    }
+
+    if (cp->lex == NULL)
+    {
+        cp->lexsize = COL_INIT;
+        cp->lex     = alloc_mem((uint_t)sizeof(*cp->lex) * cp->lexsize);
+    }
+
+    if (cp->nlex == 0 || cp->state != state)
+    {
+        cp->state        = state;
+        cp->next         = -1;
+        cp->nlex         = 1;
+        cp->lex[0].pos   = start;
+        cp->lex[0].state = state;
+    }
+
+    return cp;
+}
+
+
+///
+///  @brief    Find the no. of characters from a given position that will fit
+///            in a specified no. of columns. We stop at the end of the line.
+///
+///  @returns  Position following last character that fits (relative to dot).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int_t find_offset(int_t pos, int maxcol)
+{
+    int_t col;
+
+    pos = find_pos(t->dot + pos, t->Z, (int_t)maxcol, (bool)true, &col);
+
+    return pos - t->dot;
+}
+
+
+///
+///  @brief    Scan text from a starting position, summing the display width of
+///            each character, until we reach an ending position, exceed the
+///            maximum column (if not -1), or find the end of the line. A CR
+///            also ends the line if requested.
+///
+///            Columns are saved at regular intervals as we scan, and those
+///            saved by previous scans are used to skip over as much text as
+///            possible, so that repeated scans of a long line are bounded.
+///
+///  @returns  Position where scan ended (absolute).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t find_pos(int_t start, int_t end, int_t maxcol, bool cr,
+                      int_t *col)
+{
+    assert(col != NULL);
+
+    struct cols *cp = find_cols(start, (bool)false);
+    int_t stop = (cp == NULL) ? -1 : cp->stop;
+    uint_t count = (cp == NULL) ? 1 : cp->count;
+
+    // Find the last checkpoint we can start from.
+
+    uint_t n = (uint_t)((end - start) / COL_STEP);
+
+    if (n >= count)
+    {
+        n = count - 1;
+    }
+
+    if (maxcol != -1)
+    {
+        while (n > 0 && cp->cols[n] > maxcol)
+        {
+            --n;
+        }
+    }
 
-    // Read characters from the start of the current line, summing the width
-    // of each one, in order to calculate what column the cursor should be in.
-    // We have to do this one character at a time since the widths can vary.
+    int_t pos = start + (int_t)n * COL_STEP;
+    int_t ncol = (n == 0) ? 0 : cp->cols[n];
+    int c;
 
-    while ((c = read_edit(pos)) != EOF)
+    while (pos < end && (c = read_edit(pos - t->dot)) != EOF)
     {
+        // Save a checkpoint if we're at the next one, and if we haven't seen
+        // the end of the line yet. We don't save anything for a line until
+        // we reach its first checkpoint, so that short lines use no space.
+
+        if (pos == start + (int_t)count * COL_STEP
+            && (stop == -1 || pos <= stop))
+        {
+            if (cp == NULL)
+            {
+                cp = find_cols(start, (bool)true);
+
+                cp->stop = stop;
+            }
+
+            if (cp->count == cp->size)
+            {
+                uint_t size = (uint_t)sizeof(*cp->cols) * cp->size;
+
+                cp->cols  = expand_mem(cp->cols, size, size);
+                cp->size *= 2;
+            }
+
+            cp->cols[cp->count++] = ncol;
+
+            count = cp->count;
+        }
+
+        if (isdelim(c) || c == CR)
+        {
+            if (stop == -1)
+            {
+                stop = pos;
+
+                if (cp != NULL)
+                {
+                    cp->stop = stop;
+                }
+            }
+
+            if (isdelim(c) || cr)
+            {
+                break;
+            }
+        }
+
         int width;
 
         if (c == HT && !w.seeall)
         {
-            width = TABSIZE - (col % TABSIZE);
+            width = TABSIZE - (int)(ncol % TABSIZE);
         }
         else
         {
             width = keysize[c];
         }
 
-        if (isdelim(c) || pos == 0)
+        if (maxcol != -1 && ncol + width > maxcol)
         {
             break;
         }
 
-        col += width;
-
+        ncol += width;
         ++pos;
     }
 
-    return col;
+    *col = ncol;
+
+    return pos;
+}
+
+
+///
+///  @brief    Get time from monotonic clock.
+///
+///  @returns  Time in milliseconds.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static long get_msecs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
 }
 
 
@@ -239,6 +692,21 @@ int get_nowait(void)
 
 int get_wait(void)
 {
+    // Finish any repaint we skipped, unless there's more input waiting.
+
+    if (d.paint)
+    {
+        int c = get_nowait();
+
+        if (c != EOF)
+        {
+            return c;
+        }
+
+        paint_dpy();
+        wrefresh(d.cmd);
+    }
+
     int c = wgetch(d.cmd);
 
     if (c != ERR)
@@ -263,6 +731,7 @@ void init_dpy(void)
     {
         f.e0.display = true;
 
+        flush_term();                   // Write any buffered output
         reset_term();                   // Reset if display mode support
 
         // Note that initscr() will print an error message and exit if it
@@ -282,55 +751,153 @@ void init_dpy(void)
         keypad(stdscr, f.ed.escape ? (bool)TRUE : (bool)FALSE);
         reset_dpy((bool)true);
         check_colors();
+        color_syntax();
     }
 }
 
 
 ///
-///  @brief    Set up display window (technically, subwindow).
+///  @brief    Set up edit windows between specified rows, dividing them with
+///            horizontal lines. If there isn't enough room for all of them,
+///            then the no. of windows is reduced.
 ///
-///  @returns  Pointer to new subwindow.
+///  @returns  Nothing.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static void init_window(WINDOW **win, int pair, int top, int bot, int col, int width)
+static void init_views(int top, int bot)
 {
-    assert(win != NULL);
+    int nrows  = 1 + bot - top;         // Total no. of rows for edit windows
+    int nviews = w.nviews;
 
-    if (*win != NULL && *win != stdscr)
+    while (nviews > 1 && (nrows - (nviews - 1)) / nviews < VIEW_ROWS)
     {
-        delwin(*win);
-
-        *win = NULL;
+        --nviews;
     }
 
-    int nlines = 1 + bot - top;         // No. of rows in window
-
-    if (pair == EDIT)
+    if (w.view >= nviews)
     {
-        *win = newpad(nlines, w.maxline);
+        move_view(nviews - 1);
     }
-    else
+
+    w.nviews = nviews;
+
+    int size = (nrows - (nviews - 1)) / nviews; // No. of rows per window
+    int_t topdot = w.topdot;
+
+    for (int view = 0; view < VIEW_MAX; ++view)
     {
-        *win = subwin(stdscr, nlines, width, top, col);
-    }
+        if (view != w.view)
+        {
+            swap_view(&views[view]);    // Make window active while we set it up
 
-    check( *win != NULL );
+            if (d.rows == NULL)
+            {
+                w.topdot = topdot;      // New window starts where active one does
+            }
+        }
 
-    // Set default foreground and background colors for window
+        free_mem(&d.rows);
+        free_mem(&d.states);
 
-    wbkgd(*win, COLOR_PAIR(pair));  //lint !e835
+        if (view < nviews)
+        {
+            int last = (view == nviews - 1) ? bot : top + size - 1;
 
-    keypad(*win, f.ed.escape ? (bool)TRUE : (bool)FALSE);
+            d.nrows = 1 + last - top;
 
-    if (pair == EDIT)
-    {
-        d.minrow = top;
+            // Allocate cache of buffer positions and lexer states for each
+            // row, plus one more for the row following the edit window.
+
+            d.rows   = alloc_mem((uint_t)sizeof(*d.rows)   * (uint_t)(d.nrows + 1));
+            d.states = alloc_mem((uint_t)sizeof(*d.states) * (uint_t)(d.nrows + 1));
+
+            for (int row = 0; row <= d.nrows; ++row)
+            {
+                d.rows[row] = -1;
+            }
+
+            init_window(&d.edit, EDIT, top, last, 0, d.ncols);
+
+            if (view < nviews - 1)
+            {
+                init_window(&lines[view], LINE, last + 1, last + 1, 0, d.ncols);
+                whline(lines[view], ACS_HLINE, d.ncols);
+                wrefresh(lines[view]);
+            }
+
+            top = last + 2;
+        }
+        else if (d.edit != NULL)
+        {
+            delwin(d.edit);
+
+            d.edit  = NULL;
+            d.nrows = 0;
+        }
+
+        if (view < VIEW_MAX - 1 && view >= nviews - 1 && lines[view] != NULL)
+        {
+            delwin(lines[view]);
+
+            lines[view] = NULL;
+        }
+
+        if (view != w.view)
+        {
+            swap_view(&views[view]);
+        }
+    }
+}
+
+
+///
+///  @brief    Set up display window (technically, subwindow).
+///
+///  @returns  Pointer to new subwindow.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void init_window(WINDOW **win, int pair, int top, int bot, int col, int width)
+{
+    assert(win != NULL);
+
+    if (*win != NULL && *win != stdscr)
+    {
+        delwin(*win);
+
+        *win = NULL;
+    }
+
+    int nlines = 1 + bot - top;         // No. of rows in window
+
+    if (pair == EDIT)
+    {
+        *win = newpad(nlines, width);
+    }
+    else
+    {
+        *win = subwin(stdscr, nlines, width, top, col);
+    }
+
+    check( *win != NULL );
+
+    // Set default foreground and background colors for window
+
+    wbkgd(*win, COLOR_PAIR(pair));  //lint !e835
+
+    keypad(*win, f.ed.escape ? (bool)TRUE : (bool)FALSE);
+
+    if (pair == EDIT)
+    {
+        d.minrow = top;
         d.mincol = 0;
         d.maxrow = bot;
         d.maxcol = d.ncols - 1;
 
-        prefresh(*win, 0, d.xbias = 0, d.minrow, d.mincol, d.maxrow, d.mincol);
+        d.xbias = d.xpaint = 0;
+
+        prefresh(*win, 0, 0, d.minrow, d.mincol, d.maxrow, d.mincol);
     }
     else
     {
@@ -394,9 +961,8 @@ static void init_windows(void)
 
     edit_bot = edit_top + nrows - 1;
     cmd_bot  = cmd_top + w.nlines - 1;
-    d.nrows  = 1 + edit_bot - edit_top;
 
-    init_window(&d.edit, EDIT, edit_top, edit_bot, 0, w.maxline);
+    init_views(edit_top, edit_bot);
 
     if (f.e4.fence)
     {
@@ -412,6 +978,7 @@ static void init_windows(void)
         width -= (w.status == 0) ? STATUS_WIDTH : w.status;
 
         init_window(&d.status, STATUS, cmd_top, cmd_bot, width, w.status);
+        reset_status();
         init_window(&d.cmd, CMD, cmd_top, cmd_bot, 0, width);
     }
     else
@@ -425,350 +992,1168 @@ static void init_windows(void)
 
 
 ///
-///  @brief    Output character to command window. We do not output CR because
-///            ncurses does the following when processing LF:
-///
-///            1. Clear to end of line.
-///            2. Go to start of next line.
-///
-///            So, not only is CR not necessary, but if it preceded LF, this
-///            would result in the current line getting blanked.
+///  @brief    Lex the remainder of a line, using the state saved for the next
+///            line if we have it, and saving it if we don't.
 ///
-///  @returns  true if character output, false if display not active.
+///  @returns  Position of start of next line (or Z).
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-bool putc_cmd(int c)
+static int_t lex_end(struct cols *cp, int_t pos, int *state)
 {
-    if (!f.e0.display)
+    assert(state != NULL);
+
+    if (cp != NULL && cp->next != -1)
     {
-        return false;
+        *state = cp->endstate;
+
+        return cp->next;
     }
 
-    if (c != CR)
+    attr_t attr;
+    int c;
+
+    while ((c = read_edit(pos - t->dot)) != EOF)
     {
-        waddch(d.cmd, (chtype)c);
+        pos = lex_next(cp, pos, state, &attr);
+
+        if (isdelim(c))
+        {
+            break;
+        }
     }
 
-    return true;
+    if (cp != NULL)
+    {
+        cp->next     = pos;
+        cp->endstate = *state;
+    }
+
+    return pos;
 }
 
 
 ///
-///  @brief    See if we need to move the cursor or refresh the display.
+///  @brief    Lex the next token in a line, first saving the lexer state if
+///            we're at least COL_STEP characters past the last checkpoint.
 ///
-///  @returns  Nothing.
+///  @returns  Position following token.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-void refresh_dpy(void)
+static int_t lex_next(struct cols *cp, int_t pos, int *state, attr_t *attr)
 {
-    if (!f.e0.display || w.nlines == 0 || w.noscroll)
-    {
-        return;
-    }
-
-    if (t->dot < w.topdot || t->dot > w.botdot)
-    {
-        f.e0.window = true;             // Force repaint if too much changed
-    }
-
-    if (f.e0.window || f.e0.cursor)
+    if (cp != NULL && pos - cp->lex[cp->nlex - 1].pos >= COL_STEP)
     {
-        f.e0.cursor = false;
-
-        reset_cursor();
-
-        // We can safely change d.row and d.col after resetting cursor
-
-        int before = before_dot();
-        int total  = before + after_dot(); // Total no. of line terminators
-
-        if (d.newrow == -1)             // New cursor coordinates valid?
+        if (cp->nlex == cp->lexsize)
         {
-            int delta = before - d.line; // Get difference from last line
+            uint_t size = (uint_t)sizeof(*cp->lex) * cp->lexsize;
 
-            d.row += delta;
-            d.col = find_column();
-        }
-        else
-        {
-            d.row = d.newrow;
-            d.col = d.newcol;
+            cp->lex      = expand_mem(cp->lex, size, size);
+            cp->lexsize *= 2;
         }
 
-        // The following is a (hopefully temporary) hack to handle the situation
-        // where the buffer has data but no line delimiter.
+        cp->lex[cp->nlex].pos   = pos;
+        cp->lex[cp->nlex].state = *state;
 
-        if (total == 0)
-        {
-            if (t->Z != 0 && t->dot == t->Z)
-            {
-                d.row = 1;
-                d.col = 0;
-            }
-            else
-            {
-                d.row = 0;
-                d.col = find_column();
-            }
-        }
+        ++cp->nlex;
+    }
 
-        // If row isn't in current window, then correct value and repaint screen
+    return lex_token(pos, state, attr);
+}
 
-        if (d.row < 0)
-        {
-            d.row = 0;
-            f.e0.window = true;
-        }
-        else if (d.row >= d.nrows)
-        {
-            d.row = d.nrows - 1;
-            f.e0.window = true;
-        }
 
-        d.ybias = d.row;
+///
+///  @brief    Lex tokens up to and including the one containing a position,
+///            starting at the last checkpoint preceding it if that is past
+///            the end of the current token.
+///
+///  @returns  Position following token.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t lex_skip(struct cols *cp, int_t next, int_t pos, int *state,
+                      attr_t *attr)
+{
+    if (cp != NULL)
+    {
+        uint_t n = cp->nlex - 1;
 
-        if (f.e0.window)
+        while (n > 0 && cp->lex[n].pos > pos)
         {
-            f.e0.window = false;
-
-            refresh_edit();
+            --n;
         }
 
-        if (d.col - d.xbias > d.ncols)
+        if (cp->lex[n].pos > next)
         {
-            d.xbias = d.col - (d.ncols / 2);
+            next   = cp->lex[n].pos;
+            *state = cp->lex[n].state;
         }
+    }
 
-        set_cursor();                   // Mark the new cursor
-
-        prefresh(d.edit, 0, d.xbias, d.minrow, d.mincol, d.maxrow, d.maxcol);
+    while (next <= pos && next < t->Z)
+    {
+        next = lex_next(cp, next, state, attr);
     }
 
-    refresh_status();
-    wrefresh(d.cmd);                    // Switch back to command window
+    return next;
 }
 
 
 ///
-///  @brief    Refresh edit window.
+///  @brief    Update column checkpoints after a change to the edit buffer, in
+///            which ndelete characters at pos were replaced with ninsert
+///            characters. A position of -1 discards all checkpoints (e.g., if
+///            the width of any characters or the syntax rules have changed).
 ///
 ///  @returns  Nothing.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static void refresh_edit(void)
+void mark_column(int_t pos, int_t ndelete, int_t ninsert)
 {
-    int_t pos = len_edit((int_t)-d.ybias);
-    int row = -1;
-    int col __attribute__((unused));
-    int c;
-
-    wclear(d.edit);
-
-    w.topdot = t->dot + pos;            // First character output in window
-
-    while ((c = read_edit(pos)) != EOF)
+    for (int i = 0; i < COL_LINES; ++i)
     {
-        ++pos;
+        struct cols *cp = &cc[i];
 
-        getyx(d.edit, row, col);
-
-        chtype ch = (chtype)c;
-
-        if (isprint(c))                 // Printing chr. [32-126]
+        if (cp->count == 0)
+        {
+            continue;
+        }
+        else if (pos == -1 || (pos < cp->start && pos + ndelete > cp->start))
         {
-            waddch(d.edit, ch);
+            cp->count = 0;              // Start of scan was deleted
+            cp->nlex  = 0;
         }
-        else if (iscntrl(c))            // Control chr. [0-31, 127]
+        else if (pos + ndelete <= cp->start)
         {
-            switch (c)
+            // Change preceded scan, so shift it
+
+            cp->start += ninsert - ndelete;
+
+            if (cp->stop != -1)
+            {
+                cp->stop += ninsert - ndelete;
+            }
+
+            if (cp->next != -1)
+            {
+                cp->next += ninsert - ndelete;
+            }
+
+            for (uint_t i = 0; i < cp->nlex; ++i)
             {
-                case HT:
-                    if (w.seeall)
-                    {
-                        waddstr(d.edit, unctrl(ch));
-                    }
-                    else
-                    {
-                        waddch(d.edit, ch);
-                    }
-
-                    break;
-
-                case BS:
-                case VT:
-                case FF:
-                case LF:
-                case CR:
-                    if (w.seeall)
-                    {
-                        waddstr(d.edit, unctrl(ch));
-                    }
-
-                    break;
-
-                default:
-                    waddch(d.edit, ch);
-
-                    break;
+                cp->lex[i].pos += ninsert - ndelete;
             }
         }
-        else                            // 8-bit chr. [128-255]
+        else                            // Discard checkpoints following change
         {
-            if (w.seeall)
+            uint_t n = (uint_t)((pos - cp->start) / COL_STEP) + 1;
+
+            if (cp->count > n)
             {
-                waddstr(d.edit, table_8bit[c & 0x7f]);
+                cp->count = n;
             }
-            else
+
+            if (cp->stop >= pos)
             {
-                waddstr(d.edit, unctrl(ch));
+                cp->stop = -1;
             }
-        }
 
-        if (isdelim(c))                 // Found a delimiter (LF, VT, FF)?
-        {
-            if (row == d.maxrow)        // If at end of last row, then done
+            // Tokens may look ahead a little, so we also discard the lexer
+            // state for the last token preceding the change.
+
+            while (cp->nlex != 0 && cp->lex[cp->nlex - 1].pos + COL_STEP > pos)
             {
-                break;
+                --cp->nlex;
             }
 
-            waddch(d.edit, '\n');       // Else output newline
+            cp->next = -1;
         }
     }
+}
 
-    w.botdot = t->dot + pos;            // Last character output in window
 
-    if (row < d.maxrow)                 // Should we print EOF marker?
-    {
-        mvwaddch(d.edit, row + 1, 0, ACS_DIAMOND);
-    }
-}                                       //lint !e438 !e550
+///
+///  @brief    Make another edit window the active one, by swapping its state
+///            with that of the current active window.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void move_view(int view)
+{
+    assert(view >= 0 && view < VIEW_MAX);
+
+    swap_view(&views[view]);            // Make new window active
+
+    views[w.view] = views[view];        // Save old window's state
+
+    memset(&views[view], '\0', sizeof(views[view]));
+
+    w.view = view;
+}
 
 
 ///
-///  @brief    Un-highlight cursor.
+///  @brief    Find the start of the row following the one at pos.
 ///
-///  @returns  Nothing.
+///  @returns  Buffer position of next row, or -1 if no more rows.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static void reset_cursor(void)
+static int_t next_row(int_t pos)
 {
-    int c = d.cursor;
+    static const char delims[] = { LF, VT, FF };
 
-    if (c == HT && !w.seeall)
+    if (pos == -1 || pos >= t->Z)
     {
-        int width = TABSIZE - (d.col % TABSIZE);
-        chtype ch = mvwinch(d.edit, d.row, d.col) & ~A_REVERSE;
-
-        mvwchgat(d.edit, d.row, d.col, width, ch, EDIT, NULL);
+        return -1;
     }
-    else
+
+    // Search each block of the buffer in turn, looking for the nearest of
+    // the line delimiters, and narrowing the search each time we find one.
+
+    while (pos < t->Z)
     {
-        int width;
+        int_t start, end;
+        const char *base = block_edit(pos, &start, &end);
+        const char *p = base + pos;
+        size_t len = (size_t)(end - pos);
+        bool found = false;
 
-        if (c == EOF)
-        {
-            width = 1;
-        }
-        else
+        for (uint i = 0; i < countof(delims); ++i)
         {
-            width = keysize[c] ?: 1;
+            const char *delim = memchr(p, delims[i], len);
+
+            if (delim != NULL)
+            {
+                len   = (size_t)(delim - p) + 1;
+                found = true;
+            }
         }
 
-        for (int col = d.col; col < d.col + width; ++col)
-        {
-            chtype ch = mvwinch(d.edit, d.row, col) & ~A_REVERSE;
+        pos += (int_t)len;
 
-            mvwchgat(d.edit, d.row, col, 1, ch, EDIT, NULL);
+        if (found)
+        {
+            break;
         }
     }
+
+    return pos;
 }
 
 
 ///
-///  @brief    Reset display.
+///  @brief    Paint edit windows and status window. The E0 window flag means
+///            that all edit windows need repainting, whereas the repaint flag
+///            is set when just the active window does (e.g., if it scrolled).
 ///
 ///  @returns  Nothing.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-void reset_dpy(bool all)
+static void paint_dpy(void)
 {
-    if (!f.e0.display)
+    struct dirty dirty;
+    bool all = f.e0.window;
+
+    get_dirty(&dirty);
+
+    lc.count = 0;                       // Discard rows found for last change
+
+    reset_cursor();
+
+    // Repaint just the rows that changed, if we can.
+
+    if (!all && !repaint && dirty.start != -1 && !refresh_rows(&dirty))
     {
-        return;
+        repaint = true;
     }
 
-    if (all)
+    if (t->dot < w.topdot || t->dot > w.botdot)
     {
-        clear();
-        init_keys();
-
-        if (w.nlines == 0 || w.noscroll)
-        {
-            d.cmd = stdscr;
+        repaint = true;                 // Force repaint if dot not in window
+    }
 
-            refresh();
+    if (all || repaint)
+    {
+        f.e0.window = repaint = false;
 
-            return;
-        }
-        else
-        {
-            init_windows();
-        }
+        refresh_edit();
     }
 
-    d.ybias = d.xbias = 0;
+    set_cursor();                       // Mark the new cursor
 
-    f.e0.window = true;
+    prefresh(d.edit, 0, 0, d.minrow, d.mincol, d.maxrow, d.maxcol);
 
-    refresh_dpy();
+    paint_views(&dirty, all);
+
+    refresh_status();
+
+    d.paint   = false;
+    d.painted = get_msecs();
 }
 
 
 ///
-///  @brief    Save coordinates of 'dot' and mark its position. Note that the
-///            end of file marker uses the alternate character set.
+///  @brief    Output character to edit window, given the column it starts in.
+///            Only the part of the character that falls within the visible
+///            columns of the window is output.
 ///
-///  @returns  Nothing.
+///  @returns  Width of character, or -1 if it extends past the right edge of
+///            the window.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static void set_cursor(void)
+static int paint_chr(int c, int_t col)
 {
-    int c = d.cursor = read_edit(0);    // Save cursor character (for reset)
+    chtype ch = (chtype)c;
+    const char *str = NULL;
 
-    if (c == HT && !w.seeall)
+    if (isprint(c))                     // Printing chr. [32-126]
     {
-        int width = TABSIZE - (d.col % TABSIZE);
-        chtype ch = mvwinch(d.edit, d.row, d.col) | A_REVERSE;
-
-        mvwchgat(d.edit, d.row, d.col, width, ch, EDIT, NULL);
+        ;
     }
-    else
+    else if (iscntrl(c))                // Control chr. [0-31, 127]
     {
-        int width;
-
-        if (c == EOF)
-        {
-            width = 1;
-        }
-        else
+        switch (c)
         {
-            width = keysize[c] ?: 1;
-        }
+            case HT:
+                if (w.seeall)
+                {
+                    str = unctrl(ch);
+                }
 
-        for (int col = d.col; col < d.col + width; ++col)
-        {
-            chtype ch = mvwinch(d.edit, d.row, col) | A_REVERSE;
+                break;
 
-            mvwchgat(d.edit, d.row, col, 1, ch, EDIT, NULL);
+            case BS:
+            case VT:
+            case FF:
+            case LF:
+            case CR:
+                if (!w.seeall)
+                {
+                    return 0;
+                }
+
+                str = unctrl(ch);
+
+                break;
+
+            default:
+                str = unctrl(ch);
+
+                break;
+        }
+    }
+    else                                // 8-bit chr. [128-255]
+    {
+        if (w.seeall)
+        {
+            str = table_8bit[c & 0x7f];
+        }
+        else
+        {
+            str = unctrl(ch);
+        }
+    }
+
+    int width = (str != NULL) ? (int)strlen(str) : 1;
+
+    if (c == HT && str == NULL)
+    {
+        width = TABSIZE - (int)(col % TABSIZE);
+        str   = "";                     // Tabs are output as spaces
+    }
+
+    int_t x = col - d.xbias;            // Column in window
+
+    if (x + width > d.ncols)
+    {
+        return -1;
+    }
+    else if (x < 0 || (str != NULL && *str == NUL)) // Partly hidden, or tab
+    {
+        for (int_t i = (x < 0) ? -x : 0; i < width; ++i)
+        {
+            waddch(d.edit, ' ');
+        }
+    }
+    else if (str != NULL)
+    {
+        waddstr(d.edit, str);
+    }
+    else
+    {
+        waddch(d.edit, ch);
+    }
+
+    return width;
+}
+
+
+///
+///  @brief    Repaint one row of edit window, starting at buffer position pos.
+///            If pos is at the end of the buffer, then we print an EOF marker.
+///            Only the characters in the visible columns are output, so the
+///            cost of painting a row doesn't depend on the length of the line.
+///            If syntax highlighting is enabled, the row is lexed starting with
+///            the state saved for it, and the state at the end of the row is
+///            saved for the row that follows.
+///
+///  @returns  Buffer position of next row, or -1 if no more rows.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t paint_row(int row, int_t pos)
+{
+    wmove(d.edit, row, 0);
+    wclrtoeol(d.edit);
+
+    d.rows[row] = pos;
+
+    int state = d.states[row];
+
+    d.states[row + 1] = state;
+
+    if (pos == -1)
+    {
+        return -1;
+    }
+    else if (pos >= t->Z)
+    {
+        if (d.xbias == 0)
+        {
+            waddch(d.edit, ACS_DIAMOND);
+        }
+
+        return -1;
+    }
+
+    int_t next = pos;                   // End of current token
+    int_t col = 0;
+    attr_t attr;
+    int c;
+    struct cols *cp = d.syntax ? find_lex(pos, state) : NULL;
+
+    if (d.xbias != 0)                   // Skip characters left of window
+    {
+        pos = find_pos(pos, t->Z, (int_t)d.xbias, (bool)false, &col);
+
+        if (d.syntax && next <= pos && next < t->Z)
+        {
+            next = lex_skip(cp, next, pos, &state, &attr);
+
+            wattrset(d.edit, attr);
+        }
+    }
+
+    while ((c = read_edit(pos - t->dot)) != EOF)
+    {
+        if (d.syntax && pos == next)
+        {
+            next = lex_next(cp, next, &state, &attr);
+
+            wattrset(d.edit, attr);
+        }
+
+        ++pos;
+
+        int width = paint_chr(c, col);
+
+        if (isdelim(c))                 // Found a delimiter (LF, VT, FF)?
+        {
+            break;
+        }
+        else if (width == -1)           // Skip characters right of window
+        {
+            if (d.syntax && pos < t->Z)
+            {
+                pos = lex_end(cp, next, &state); // Get state for next row
+            }
+            else
+            {
+                pos = next_row(pos);
+            }
+
+            break;
+        }
+
+        col += width;
+    }
+
+    wattrset(d.edit, A_NORMAL);
+
+    d.states[row + 1] = state;
+
+    return pos;
+}
+
+
+///
+///  @brief    Repaint edit window from specified row to bottom.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void paint_rows(int row, int_t pos)
+{
+    while (row < d.nrows)
+    {
+        pos = paint_row(row++, pos);
+    }
+
+    d.rows[d.nrows] = pos;
+
+    w.botdot = (pos == -1) ? t->Z : pos; // Last character output in window
+}
+
+
+///
+///  @brief    Update edit windows other than the active one. If a change only
+///            affected text above a window, then we just adjust the positions
+///            saved for its rows, since the text they contain is the same.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void paint_views(const struct dirty *dirty, bool all)
+{
+    assert(dirty != NULL);
+
+    if (!all && dirty->start == -1)
+    {
+        return;
+    }
+
+    int_t end = dirty->end - dirty->delta; // End of change in old buffer
+
+    for (int view = 0; view < w.nviews; ++view)
+    {
+        if (view == w.view)
+        {
+            continue;
+        }
+
+        swap_view(&views[view]);
+
+        bool paint = all;
+
+        if (!paint && end < w.topdot && d.rows[0] == w.topdot)
+        {
+            w.topdot += dirty->delta;
+            w.botdot += dirty->delta;
+
+            for (int row = 0; row <= d.nrows; ++row)
+            {
+                if (d.rows[row] != -1)
+                {
+                    d.rows[row] += dirty->delta;
+                }
+            }
+
+            // A change above the window can still change how it's colored.
+
+            if (d.syntax && get_syntax(w.topdot) != d.states[0])
+            {
+                paint = true;
+            }
+        }
+        else if (!paint && !refresh_rows(dirty))
+        {
+            if (dirty->start < w.topdot)
+            {
+                w.topdot = dirty->start; // Top of window was changed
+            }
+
+            paint = true;
+        }
+
+        if (paint)
+        {
+            w.topdot    = start_row(w.topdot);
+            d.xpaint    = d.xbias;
+            d.states[0] = d.syntax ? get_syntax(w.topdot) : 0;
+
+            paint_rows(0, w.topdot);
+        }
+
+        prefresh(d.edit, 0, 0, d.minrow, d.mincol, d.maxrow, d.maxcol);
+
+        swap_view(&views[view]);
+    }
+}
+
+
+///
+///  @brief    Output character to command window. We do not output CR because
+///            ncurses does the following when processing LF:
+///
+///            1. Clear to end of line.
+///            2. Go to start of next line.
+///
+///            So, not only is CR not necessary, but if it preceded LF, this
+///            would result in the current line getting blanked.
+///
+///  @returns  true if character output, false if display not active.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool putc_cmd(int c)
+{
+    if (!f.e0.display)
+    {
+        return false;
+    }
+
+    if (c != CR)
+    {
+        waddch(d.cmd, (chtype)c);
+    }
+
+    return true;
+}
+
+
+///
+///  @brief    See if we need to move the cursor or refresh the display. The
+///            cursor position is always updated, but the edit window is only
+///            repainted if enough time has passed since it was last painted,
+///            so that rapid updates (such as when keys are auto-repeating)
+///            are coalesced. Any repaint that is skipped here is done before
+///            we next wait for input.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void refresh_dpy(void)
+{
+    if (!f.e0.display || w.nlines == 0 || w.noscroll)
+    {
+        return;
+    }
+
+    if (!f.e0.cursor && (t->dot < w.topdot || t->dot > w.botdot))
+    {
+        repaint = true;                 // Force repaint if too much changed
+    }
+
+    if (f.e0.window || repaint || f.e0.cursor)
+    {
+        f.e0.cursor = false;
+
+        update_dpy();
+    }
+
+    if (d.paint)
+    {
+        if (f.e4.redraw || get_msecs() - d.painted >= w.redraw)
+        {
+            paint_dpy();
+        }
+    }
+    else
+    {
+        refresh_status();
+    }
+
+    wrefresh(d.cmd);                    // Switch back to command window
+}
+
+
+///
+///  @brief    Refresh edit window.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void refresh_edit(void)
+{
+    w.topdot = t->dot + len_edit((int_t)-d.ybias); // First character in window
+    d.xpaint = d.xbias;
+
+    d.states[0] = d.syntax ? get_syntax(w.topdot) : 0;
+
+    paint_rows(0, w.topdot);
+}
+
+
+///
+///  @brief    Repaint just those rows of edit window affected by changes to
+///            the edit buffer. Rows that follow the changes are scrolled up
+///            or down if the no. of lines changed, rather than repainted.
+///
+///  @returns  true if window updated, false if full repaint needed.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool refresh_rows(const struct dirty *dirty)
+{
+    assert(dirty != NULL);
+    assert(d.rows != NULL);
+
+    int_t start = dirty->start;
+    int_t end   = dirty->end - dirty->delta; // End of change in old buffer
+
+    if (start < w.topdot || d.rows[0] != w.topdot)
+    {
+        return false;                   // Change is above window
+    }
+    else if (d.rows[d.nrows] != -1 && start >= d.rows[d.nrows])
+    {
+        return true;                    // Change is below window
+    }
+
+    // Find the first row affected. We back up a character in case we're
+    // appending to a row that doesn't end with a delimiter.
+
+    int_t first = (start > w.topdot) ? start - 1 : start;
+    int top = 0;
+
+    while (top < d.nrows - 1 && d.rows[top + 1] != -1
+           && d.rows[top + 1] <= first)
+    {
+        ++top;
+    }
+
+    // Find the first row following the change whose text is unaffected.
+
+    int bot = top + 1;
+
+    while (bot <= d.nrows && d.rows[bot] != -1 && d.rows[bot] <= end)
+    {
+        ++bot;
+    }
+
+    if (bot >= d.nrows || d.rows[bot] == -1)
+    {
+        paint_rows(top, d.rows[top]);   // Repaint everything below change
+
+        return true;
+    }
+
+    // Count the no. of rows the changed text now occupies.
+
+    int_t pos;
+    int_t target = d.rows[bot] + dirty->delta;
+    int nrows    = count_rows(d.rows[top], target, d.nrows - top, &pos);
+
+    if (pos != target)
+    {
+        paint_rows(top, d.rows[top]);   // Changed text fills rest of window
+
+        return true;
+    }
+
+    // Scroll the unchanged rows into their new positions, and update the
+    // positions cached for them.
+
+    int shift = nrows - (bot - top);
+
+    if (shift != 0)
+    {
+        wmove(d.edit, (shift > 0) ? bot : bot + shift, 0);
+        winsdelln(d.edit, shift);
+    }
+
+    if (shift > 0)
+    {
+        for (int row = d.nrows; row >= bot + shift; --row)
+        {
+            d.rows[row]   = d.rows[row - shift];
+            d.states[row] = d.states[row - shift];
+        }
+    }
+    else if (shift < 0)
+    {
+        for (int row = bot + shift; row <= d.nrows + shift; ++row)
+        {
+            d.rows[row]   = d.rows[row - shift];
+            d.states[row] = d.states[row - shift];
+        }
+    }
+
+    for (int row = bot + shift; row <= d.nrows + (shift < 0 ? shift : 0); ++row)
+    {
+        if (d.rows[row] != -1)
+        {
+            d.rows[row] += dirty->delta;
+        }
+    }
+
+    // Repaint the changed rows, then any rows exposed at bottom of window.
+    // If the lexer state at the end of the changed rows is different (e.g.,
+    // because a comment was started or ended), then we also repaint the rows
+    // that follow, until we find one whose starting state is unchanged.
+
+    int row   = bot + shift;
+    int last  = d.nrows + (shift < 0 ? shift : 0);
+    int state = d.states[row];
+
+    pos = d.rows[top];
+
+    for (int i = top; i < row; ++i)
+    {
+        pos = paint_row(i, pos);
+    }
+
+    while (row < last && d.states[row] != state)
+    {
+        state = d.states[row + 1];
+
+        (void)paint_row(row, d.rows[row]);
+
+        ++row;
+    }
+
+    if (shift < 0)
+    {
+        paint_rows(d.nrows + shift, d.rows[d.nrows + shift]);
+    }
+    else
+    {
+        pos = d.rows[d.nrows];
+
+        w.botdot = (pos == -1) ? t->Z : pos;
+    }
+
+    return true;
+}
+
+
+///
+///  @brief    Un-highlight cursor.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void reset_cursor(void)
+{
+    int c = d.cursor;
+    int x = d.ccol - d.xpaint;          // Column in window
+
+    if (c == HT && !w.seeall)
+    {
+        int width = TABSIZE - (d.ccol % TABSIZE);
+        chtype ch = mvwinch(d.edit, d.crow, x) & ~A_REVERSE;
+
+        mvwchgat(d.edit, d.crow, x, width, ch, (short)PAIR_NUMBER(ch), NULL);
+    }
+    else
+    {
+        int width;
+
+        if (c == EOF)
+        {
+            width = 1;
+        }
+        else
+        {
+            width = keysize[c] ?: 1;
+        }
+
+        for (int col = x; col < x + width; ++col)
+        {
+            chtype ch = mvwinch(d.edit, d.crow, col) & ~A_REVERSE;
+
+            mvwchgat(d.edit, d.crow, col, 1, ch, (short)PAIR_NUMBER(ch), NULL);
+        }
+    }
+}
+
+
+///
+///  @brief    Reset display.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void reset_dpy(bool all)
+{
+    if (!f.e0.display)
+    {
+        return;
+    }
+
+    if (all)
+    {
+        clear();
+        init_keys();
+
+        if (w.nlines == 0 || w.noscroll)
+        {
+            d.cmd = stdscr;
+
+            refresh();
+
+            return;
+        }
+        else
+        {
+            init_windows();
+        }
+    }
+
+    d.ybias = d.xbias = 0;
+
+    f.e0.window = true;
+
+    refresh_dpy();
+}
+
+
+///
+///  @brief    Select new active edit window. Dot is left where it is, so the
+///            new window scrolls to it if it's not already visible.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void select_view(int view)
+{
+    assert(view >= 0 && view < w.nviews);
+
+    if (view == w.view)
+    {
+        return;
+    }
+
+    bool active = (f.e0.display && w.nlines != 0 && !w.noscroll
+                   && d.rows != NULL);
+
+    if (active)
+    {
+        reset_cursor();                 // Old window no longer has cursor
+
+        prefresh(d.edit, 0, 0, d.minrow, d.mincol, d.maxrow, d.maxcol);
+    }
+
+    move_view(view);
+
+    d.row = 0;
+
+    if (active && d.rows != NULL && d.rows[0] == w.topdot
+        && t->dot >= w.topdot && t->dot <= w.botdot)
+    {
+        while (d.row < d.nrows - 1 && d.rows[d.row + 1] != -1
+               && d.rows[d.row + 1] <= t->dot)
+        {
+            ++d.row;
+        }
+    }
+    else
+    {
+        repaint = true;
+    }
+
+    d.ybias  = d.row;
+    d.line   = before_dot();
+    d.newrow = d.newcol = -1;
+
+    f.e0.cursor = true;
+}
+
+
+///
+///  @brief    Save coordinates of 'dot' and mark its position. Note that the
+///            end of file marker uses the alternate character set.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void set_cursor(void)
+{
+    int c = d.cursor = read_edit(0);    // Save cursor character (for reset)
+    int x = d.col - d.xpaint;           // Column in window
+
+    if (c == HT && !w.seeall)
+    {
+        int width = TABSIZE - (d.col % TABSIZE);
+        chtype ch = mvwinch(d.edit, d.row, x) | A_REVERSE;
+
+        mvwchgat(d.edit, d.row, x, width, ch, (short)PAIR_NUMBER(ch), NULL);
+    }
+    else
+    {
+        int width;
+
+        if (c == EOF)
+        {
+            width = 1;
+        }
+        else
+        {
+            width = keysize[c] ?: 1;
+        }
+
+        for (int col = x; col < x + width; ++col)
+        {
+            chtype ch = mvwinch(d.edit, d.row, col) | A_REVERSE;
+
+            mvwchgat(d.edit, d.row, col, 1, ch, (short)PAIR_NUMBER(ch), NULL);
+        }
+    }
+
+    d.crow = d.row;                     // Save coordinates (for reset)
+    d.ccol = d.col;
+}
+
+
+///
+///  @brief    Find the start of the row containing a buffer position.
+///
+///  @returns  Buffer position of start of row.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t start_row(int_t pos)
+{
+    if (pos > t->Z)
+    {
+        pos = t->Z;
+    }
+
+    while (pos > 0 && !isdelim(read_edit(pos - 1 - t->dot)))
+    {
+        --pos;
+    }
+
+    return pos;
+}
+
+
+///
+///  @brief    Exchange the state of an edit window with that of the active
+///            window. Since this is its own inverse, the same call is used to
+///            swap an inactive window in, and to swap it back out again.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void swap_view(struct view *view)
+{
+    assert(view != NULL);
+
+    struct view save =
+    {
+        .edit   = d.edit,
+        .minrow = d.minrow,
+        .maxrow = d.maxrow,
+        .nrows  = d.nrows,
+        .ybias  = d.ybias,
+        .xbias  = d.xbias,
+        .xpaint = d.xpaint,
+        .topdot = w.topdot,
+        .botdot = w.botdot,
+        .rows   = d.rows,
+        .states = d.states,
+    };
+
+    d.edit   = view->edit;
+    d.minrow = view->minrow;
+    d.maxrow = view->maxrow;
+    d.nrows  = view->nrows;
+    d.ybias  = view->ybias;
+    d.xbias  = view->xbias;
+    d.xpaint = view->xpaint;
+    w.topdot = view->topdot;
+    w.botdot = view->botdot;
+    d.rows   = view->rows;
+    d.states = view->states;
+
+    *view = save;
+}
+
+
+///
+///  @brief    Update cursor coordinates, and figure out whether we need to
+///            repaint the entire edit window.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void update_dpy(void)
+{
+    int before = before_dot();
+    int total  = before + after_dot(); // Total no. of line terminators
+
+    if (d.newrow == -1)                 // New cursor coordinates valid?
+    {
+        int delta = before - d.line;    // Get difference from last line
+
+        d.row += delta;
+        d.col = find_column();
+    }
+    else
+    {
+        d.row = d.newrow;
+        d.col = d.newcol;
+    }
+
+    // The following is a (hopefully temporary) hack to handle the situation
+    // where the buffer has data but no line delimiter.
+
+    if (total == 0)
+    {
+        if (t->Z != 0 && t->dot == t->Z)
+        {
+            d.row = 1;
+            d.col = 0;
+        }
+        else
+        {
+            d.row = 0;
+            d.col = find_column();
         }
     }
 
-    d.line = before_dot();              // Save current line number
+    // If row isn't in current window, then correct value and repaint screen
+
+    if (d.row < 0)
+    {
+        d.row = 0;
+        repaint = true;
+    }
+    else if (d.row >= d.nrows)
+    {
+        d.row = d.nrows - 1;
+        repaint = true;
+    }
+
+    d.ybias = d.row;
+
+    // If column isn't in current window, then shift window horizontally.
+    // Since we only paint the visible columns, we have to repaint if the
+    // horizontal bias changes.
+
+    if (d.col - d.xbias >= d.ncols)
+    {
+        d.xbias = d.col - (d.ncols / 2);
+    }
+    else if (d.col < d.xbias)
+    {
+        d.xbias = (d.col < d.ncols) ? 0 : d.col - (d.ncols / 2);
+    }
+
+    if (d.xbias != d.xpaint)
+    {
+        repaint = true;
+    }
+
+    d.line = before;                    // Save current line number
     d.newrow = d.newcol = -1;           // Reinitialize new cursor coordinates
+    d.paint = true;                     // Edit window needs painting
 }
@@ -80,6 +80,8 @@ void exec_E_pct(struct cmd *cmd)
                 }
             }
 
+            rename_output(ofile);       // Replace any existing file
+
             close_output(stream);
 
             if (cmd->colon)
@@ -90,7 +90,10 @@ void exec_EC(struct cmd *cmd)
 
     if (!cmd->n_set)
     {
-        close_files();
+        if (!f.e3.bgsave || !start_save())
+        {
+            close_files();
+        }
     }
     else                                // nEC - set size of edit buffer
     {
@@ -51,9 +51,10 @@ void exec_EK(struct cmd *cmd)
 
     reset_pages(ostream);
 
-    // Delete any file we created. Use the temp name if we have one. Note that
-    // this needs to be done before closing the file, because that will delete
-    // strings that we reference below.
+    // Delete any file we created. Use the temp name if we have one, and do
+    // nothing if the temp file has no name, since closing it will delete it.
+    // Note that this needs to be done before closing the file, because that
+    // will delete strings that we reference below.
 
     if (ofile->temp != NULL)
     {
@@ -62,7 +63,7 @@ void exec_EK(struct cmd *cmd)
             throw(E_ERR, ofile->temp);
         }
     }
-    else if (ofile->name != NULL)
+    else if (ofile->name != NULL && !ofile->anon)
     {
         if (remove(ofile->name) != 0)
         {
@@ -35,6 +35,7 @@
 #include "estack.h"
 #include "exec.h"
 #include "file.h"
+#include "term.h"
 
 
 ///
@@ -55,6 +56,7 @@ void exec_EL(struct cmd *cmd)
     uint_t len       = cmd->text1.len;
     uint stream      = OFILE_LOG;
 
+    flush_log();                        // Write anything still buffered for log
     close_output(stream);
 
     if (len == 0)
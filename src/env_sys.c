@@ -34,6 +34,7 @@
 #include "ascii.h"
 #include "exec.h"
 #include "file.h"
+#include "search.h"
 #include "term.h"
 
 
@@ -93,6 +94,9 @@ void exit_EG(void)
 {
     if (eg_command[0] != NUL)
     {
+        flush_term();
+        flush_log();
+
         if (execlp("/bin/sh", "sh", "-c", eg_command, NULL) == -1)
         {
             perror("EG command failed");
@@ -191,6 +195,18 @@ void init_env(void)
 ///                   = 0 - Background process, attached to a terminal.
 ///                   < 0 - Child or detached process.
 ///
+///            -6EJ - The state of any background save (see check_save()).
+///
+///            -7EJ - The memory used by the trigram index, in kilobytes.
+///
+///            -8EJ - The time taken to build the trigram index, in msecs.
+///
+///            -9EJ - The min. no. of positions for which a search is split
+///                   among worker processes. m,-9EJ sets it.
+///
+///           -10EJ - The no. of worker processes for a search, or 0 for one
+///                   per CPU. m,-10EJ sets it.
+///
 ///             0EJ - Process ID
 ///            0:EJ - Parent process ID
 ///
@@ -198,8 +214,20 @@ void init_env(void)
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-int teco_env(int n_arg, bool colon)
+int teco_env(int n_arg, int_t m_arg, bool m_set, bool colon)
 {
+    if (m_set)
+    {
+        if (n_arg != -9 && n_arg != -10)
+        {
+            throw(E_NYI);               // Only some values can be set
+        }
+        else if (m_arg < 0)
+        {
+            throw(E_ARG);               // Improper arguments
+        }
+    }
+
     switch (n_arg)
     {
         case 2:
@@ -239,6 +267,21 @@ int teco_env(int n_arg, bool colon)
             }
         }
 
+        case -6:
+            return check_save(SAVE_POLL);
+
+        case -7:
+            return index_size();
+
+        case -8:
+            return index_time();
+
+        case -9:
+            return split_size(m_set ? m_arg : -1);
+
+        case -10:
+            return split_workers(m_set ? m_arg : -1);
+
         default:
             throw(E_NYI);               // No such EJ command
     }
@@ -407,7 +407,9 @@ noreturn void (throw)(
         case E_KEY:
         case E_LOC:
         case E_POP:
+        case E_RUL:
         case E_SRH:
+        case E_SYS:
         case E_TAG:
             err_str = va_arg(args, const char *);
             convert(err_buf, (uint)sizeof(err_buf), err_str,
@@ -453,6 +455,8 @@ noreturn void (throw)(
             error, err_str, file_str);
     }
 
+    flush_log();                        // Make sure log has error message
+
     if (f.et.abort)                     // Abort on error?
     {
         exit(EXIT_FAILURE);
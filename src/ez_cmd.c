@@ -32,20 +32,35 @@
 #include <unistd.h>
 
 #include "teco.h"
+#include "ascii.h"
 #include "editbuf.h"
 #include "errcodes.h"
 #include "estack.h"
 #include "exec.h"
 #include "file.h"
+#include "qreg.h"
 
 
-#define EZ_SIZE         (KB * 4)        ///< Allocate memory in 4 KB chunks
+#define EZ_SIZE         (KB * 4)        ///< Initial allocation for output
+
+#define EZ_BUFFER       (-1)            ///< nEZ value for edit buffer
 
 tstring ez = { .data = NULL, .len = 0 }; ///< Output from EZ command
 
 
+// Local functions
+
+static uint_t read_buffer(FILE *fp, uint_t limit);
+
+static uint_t read_text(FILE *fp, tbuffer *text, uint_t limit);
+
+
 ///
-///  @brief    Execute EZ command: execute system command.
+///  @brief    Execute EZ command: execute system command. The output of the
+///            command is read directly into its destination, which is either
+///            Q-register + (the default), the edit buffer at dot (-1EZ), or
+///            the Q-register whose name is specified by n (e.g., ^^AEZ). If
+///            m is specified, no more than m bytes are read.
 ///
 ///  @returns  Nothing.
 ///
@@ -57,13 +72,28 @@ void exec_EZ(struct cmd *cmd)
 
     char syscmd[PATH_MAX];              // System command, and input buffer
     FILE *fp;                           //< File descriptor for pipe
-    size_t size;                        //< Total no. of bytes read
+    int qindex = -1;                    //< Q-register index, if any
+    uint_t limit = (uint_t)-1;          //< Maximum no. of bytes to read
 
     if (cmd->text1.len == 0)            // Any command string?
     {
         return;                         // No
     }
 
+    if (cmd->m_set)
+    {
+        limit = (uint_t)cmd->m_arg;
+    }
+
+    if (cmd->n_set && cmd->n_arg != EZ_BUFFER && cmd->n_arg != '+')
+    {
+        if (cmd->n_arg < 0 || cmd->n_arg > CHAR_MAX
+            || (qindex = get_qindex((int)cmd->n_arg, (bool)false)) == -1)
+        {
+            throw(E_ARG);               // Improper arguments
+        }
+    }
+
     tstring buf = build_string(cmd->text1.data, cmd->text1.len);
 
     int nbytes = snprintf(syscmd, sizeof(syscmd), "%s 2>&1", buf.data);
@@ -87,20 +117,42 @@ void exec_EZ(struct cmd *cmd)
         throw(E_ERR, syscmd);           // General error
     }
 
-    ez.len = EZ_SIZE;
-    ez.data = alloc_mem(ez.len);
-
-    uint_t pos = 0;
+    uint_t total;                       // Total no. of bytes read
 
-    while ((size = fread(ez.data + pos, 1uL, (size_t)EZ_SIZE, fp)) > 0)
+    if (cmd->n_set && cmd->n_arg == EZ_BUFFER)
     {
-        if (size + pos == ez.len)
+        total = read_buffer(fp, limit);
+    }
+    else
+    {
+        tbuffer text;
+
+        total = read_text(fp, &text, limit);
+
+        if (qindex != -1)               // Named Q-register?
         {
-            ez.data = expand_mem(ez.data, ez.len, EZ_SIZE);
-            ez.len += EZ_SIZE;
+            if (text.len == 0)
+            {
+                free_mem(&text.data);
+                delete_qtext(qindex);
+            }
+            else
+            {
+                store_qtext(qindex, &text);
+            }
         }
+        else                            // No, it's Q-register +
+        {
+            free_mem(&ez.data);
 
-        pos += (uint_t)size;
+            ez.data = text.data;
+            ez.len  = text.len;
+        }
+    }
+
+    if (total == limit && getc(fp) != EOF)
+    {
+        tprint("%%Output truncated to %lu bytes\n", (ulong)limit);
     }
 
     if (ferror(fp) || pclose(fp) == -1)
@@ -115,8 +167,6 @@ void exec_EZ(struct cmd *cmd)
         throw(E_ERR, syscmd);           // General error
     }
 
-    ez.len = pos;                       // Length = total bytes read
-
     if (cmd->colon)
     {
         push_x(SUCCESS, X_OPERAND);
@@ -125,3 +175,113 @@ void exec_EZ(struct cmd *cmd)
     return;
 }
 
+
+///
+///  @brief    Read output of system command into edit buffer at dot. Each
+///            block is inserted as soon as it is read, so that we never hold
+///            more than one block outside the edit buffer.
+///
+///  @returns  No. of bytes read.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static uint_t read_buffer(FILE *fp, uint_t limit)
+{
+    assert(fp != NULL);
+
+    char block[EZ_SIZE];
+    uint_t total = 0;
+    size_t size;
+
+    while (total < limit)
+    {
+        size = sizeof(block);
+
+        if (size > (size_t)(limit - total))
+        {
+            size = (size_t)(limit - total);
+        }
+
+        if ((size = fread(block, 1uL, size, fp)) == 0)
+        {
+            break;
+        }
+
+        if (!insert_edit(block, size))
+        {
+            pclose(fp);
+
+            throw(E_MEM);               // Memory overflow
+        }
+
+        total += (uint_t)size;
+    }
+
+    last_len = total;
+
+    return total;
+}
+
+
+///
+///  @brief    Read output of system command into text buffer. The buffer is
+///            doubled in size each time it fills up, so that the cost of
+///            reading the output is linear in its size.
+///
+///  @returns  No. of bytes read.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static uint_t read_text(FILE *fp, tbuffer *text, uint_t limit)
+{
+    assert(fp != NULL);
+    assert(text != NULL);
+
+    *text = alloc_tbuf(EZ_SIZE);
+
+    size_t size;
+
+    while (text->len < limit)
+    {
+        if (text->len == text->size)
+        {
+            text->data  = expand_mem(text->data, text->size, text->size);
+            text->size *= 2;
+        }
+
+        size = (size_t)(text->size - text->len);
+
+        if (size > (size_t)(limit - text->len))
+        {
+            size = (size_t)(limit - text->len);
+        }
+
+        if ((size = fread(text->data + text->len, 1uL, size, fp)) == 0)
+        {
+            break;
+        }
+
+        text->len += (uint_t)size;
+    }
+
+    return text->len;
+}
+
+
+///
+///  @brief    Scan EZ command.
+///
+///  @returns  false (command is not an operand or operator).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool scan_EZ(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    reject_neg_m(cmd->m_set, cmd->m_arg);
+    reject_dcolon(cmd->dcolon);
+    scan_texts(cmd, 1, ESC);
+
+    return false;
+}
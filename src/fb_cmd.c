@@ -1,6 +1,6 @@
 ///
 ///  @file    fb_cmd.c
-///  @brief   Execute FB and FC commands.
+///  @brief   Execute FA, FB, and FC commands.
 ///
 ///  @copyright 2019-2022 Franklin P. Johnston / Nowwith Treble Software
 ///
@@ -35,6 +35,7 @@
 #include "eflags.h"
 #include "estack.h"
 #include "exec.h"
+#include "qreg.h"
 #include "search.h"
 
 
@@ -42,9 +43,52 @@
 
 static void exec_search(struct cmd *cmd, bool replace);
 
+static void get_range(struct cmd *cmd, struct search *s);
+
+
+///
+///  @brief    Execute FA command: find all occurrences of the search string
+///            within the bounds, and store their positions in a Q-register,
+///            one per line. Dot is not changed. If colon-modified, return the
+///            no. of occurrences.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void exec_FA(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    if (cmd->text1.len != 0)
+    {
+        build_search(cmd->text1.data, cmd->text1.len);
+    }
+
+    struct search s;
+    tbuffer list = { .data = NULL, .size = 0, .len = 0, .pos = 0 };
+
+    get_range(cmd, &s);
+
+    int_t count = count_all(&s, &list);
+
+    delete_qtext(cmd->qindex);
+
+    if (list.data != NULL)
+    {
+        store_qtext(cmd->qindex, &list);
+    }
+
+    if (cmd->colon)
+    {
+        push_x(count, X_OPERAND);
+    }
+}
+
 
 ///
-///  @brief    Execute FB command: bounded search.
+///  @brief    Execute FB command: bounded search. If double colon-modified,
+///            count the occurrences within the bounds, without moving dot.
 ///
 ///  @returns  Nothing.
 ///
@@ -57,7 +101,9 @@ void exec_FB(struct cmd *cmd)
 
 
 ///
-///  @brief    Execute FC command: bounded search and replace.
+///  @brief    Execute FC command: bounded search and replace. If double colon-
+///            modified, replace all occurrences within the bounds, and return
+///            the no. of replacements.
 ///
 ///  @returns  Nothing.
 ///
@@ -90,7 +136,23 @@ static void exec_search(struct cmd *cmd, bool replace)
     s.type  = SEARCH_S;
     s.count = 1;
 
-    if (cmd->m_set)
+    if (cmd->dcolon)
+    {
+        get_range(cmd, &s);
+
+        if (replace)                    // m,n::FC => replace all in range
+        {
+            push_x(replace_all(&s, cmd->text2.data, cmd->text2.len),
+                   X_OPERAND);
+        }
+        else                            // m,n::FB => count all in range
+        {
+            push_x(count_all(&s, NULL), X_OPERAND);
+        }
+
+        return;
+    }
+    else if (cmd->m_set)
     {
         bool reverse = (cmd->m_arg > cmd->n_arg);
 
@@ -136,6 +198,66 @@ static void exec_search(struct cmd *cmd, bool replace)
 }
 
 
+///
+///  @brief    Set up search block for the range of an FA, ::FB, or ::FC command,
+///            which is always searched forward.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void get_range(struct cmd *cmd, struct search *s)
+{
+    assert(cmd != NULL);
+    assert(s != NULL);
+
+    int_t start, end;
+
+    if (cmd->m_set)
+    {
+        start = (cmd->m_arg < cmd->n_arg) ? cmd->m_arg : cmd->n_arg;
+        end   = (cmd->m_arg < cmd->n_arg) ? cmd->n_arg : cmd->m_arg;
+    }
+    else if (cmd->n_arg <= 0)
+    {
+        start = t->dot + len_edit(cmd->n_arg);
+        end   = t->dot;
+    }
+    else
+    {
+        start = t->dot;
+        end   = t->dot + len_edit(cmd->n_arg);
+    }
+
+    s->type       = SEARCH_S;
+    s->count      = 1;
+    s->search     = search_forward;
+    s->text_start = start - t->dot;
+    s->text_end   = end - t->dot;
+}
+
+
+///
+///  @brief    Scan FA command.
+///
+///  @returns  false (command is not an operand or operator).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool scan_FA(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    default_n(cmd, (int_t)1);           // FA => 1FA
+    reject_neg_m(cmd->m_set, cmd->m_arg);
+    reject_dcolon(cmd->dcolon);
+    scan_qreg(cmd);
+    scan_texts(cmd, 1, ESC);
+
+    return false;
+}
+
+
 ///
 ///  @brief    Scan FB command.
 ///
@@ -149,7 +271,6 @@ bool scan_FB(struct cmd *cmd)
 
     default_n(cmd, (int_t)1);           // FB => 1FB
     reject_neg_m(cmd->m_set, cmd->m_arg);
-    reject_dcolon(cmd->dcolon);
     scan_texts(cmd, 1, ESC);
 
     return false;
@@ -169,7 +290,6 @@ bool scan_FC(struct cmd *cmd)
 
     default_n(cmd, (int_t)1);           // FC => 1FC
     reject_neg_m(cmd->m_set, cmd->m_arg);
-    reject_dcolon(cmd->dcolon);
     scan_texts(cmd, 2, ESC);
 
     return false;
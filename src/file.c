@@ -107,6 +107,7 @@ void close_output(uint stream)
 
     ofile->name   = NULL;
     ofile->temp   = NULL;
+    ofile->anon   = false;
     ofile->backup = false;
 }
 
@@ -120,6 +121,8 @@ void close_output(uint stream)
 
 void exit_files(void)
 {
+    (void)check_save(SAVE_WAIT);        // Wait for any background save
+
     for (uint i = 0; i < OFILE_MAX; ++i)
     {
         close_output(i);
@@ -319,6 +322,8 @@ struct ifile *open_input(const char *name, uint stream, bool colon)
 {
     assert(name != NULL);               // Error if no input file name
 
+    (void)check_save(SAVE_WAIT);        // Wait for any background save
+
     close_input(stream);                // Close input file if open
 
     // Make canonical form of file name (w/ absolute path)
@@ -397,6 +402,8 @@ struct ofile *open_output(const char *name, uint stream, bool colon, int c)
     assert(name != NULL);               // Error if no output file name
     assert(strchr("BLW%", c) != NULL);  // Ensure it's EB, EL, EW, or E%
 
+    (void)check_save(SAVE_WAIT);        // Wait for any background save
+
     struct ofile *ofile = &ofiles[stream];
 
     // Note: EL will always close its file before calling us.
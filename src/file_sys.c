@@ -24,9 +24,16 @@
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
+#if     defined(__linux__)
+
+#define _GNU_SOURCE                     ///< For O_TMPFILE and fallocate()
+
+#endif
+
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>                      // for open(), fallocate()
 #include <glob.h>                       // for glob()
 #include <libgen.h>                     // for dirname()
 #include <limits.h>
@@ -39,6 +46,7 @@
 
 #include "teco.h"
 #include "ascii.h"
+#include "editbuf.h"
 #include "eflags.h"
 #include "errcodes.h"
 #include "file.h"
@@ -56,8 +64,14 @@ static char **next_file;                ///< Next file in pglob
 
 static struct ifile *find_file(const char *name, uint stream, const char *type);
 
+static void link_temp(struct ofile *ofile);
+
 static uint_t parse_file(const char *file, char *dir, char *base);
 
+static void sync_dir(const char *name);
+
+static void sync_output(struct ofile *ofile);
+
 
 ///
 ///  @brief    Try to open command file; if failure, then try again with TECO
@@ -205,6 +219,56 @@ int get_wild(void)
 }
 
 
+///
+///  @brief    Give an anonymous output file a unique temporary name in the same
+///            directory as the file it will replace, so that the new data is
+///            safely on disk before anything happens to the original, and so
+///            that the original can then be atomically replaced by a rename.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void link_temp(struct ofile *ofile)
+{
+    assert(ofile != NULL);              // Error if no output file
+    assert(ofile->anon);                // Error if file has a name
+
+    char dir[strlen(ofile->name) + 1];
+    char proc_name[sizeof("/proc/self/fd/") + 10 + 1];
+    char tempfile[PATH_MAX];
+
+    (void)parse_file(ofile->name, dir, NULL);
+
+    snprintf(proc_name, sizeof(proc_name), "/proc/self/fd/%d",
+             fileno(ofile->fp));
+
+    // The name is unique to this process, but try a few others in case one
+    // is left over from an earlier process with the same ID.
+
+    for (uint i = 0; ; ++i)
+    {
+        int nbytes = snprintf(tempfile, sizeof(tempfile), "%s_teco_%d_%u",
+                              dir, (int)getpid(), i);
+
+        if (linkat(AT_FDCWD, proc_name, AT_FDCWD, tempfile,
+                   AT_SYMLINK_FOLLOW) == 0)
+        {
+            ofile->temp = alloc_mem((uint_t)(uint)nbytes + 1);
+            ofile->anon = false;
+
+            strcpy(ofile->temp, tempfile);
+
+            return;
+        }
+        else if (errno != EEXIST || i == 100)
+        {
+            throw(E_ERR, ofile->name);  // General error
+        }
+    }
+}
+
+
 ///
 ///  @brief    Open temp file name. We are passed the output file name the
 ///            user specified, but we can't use it if we are opening it for
@@ -241,20 +305,62 @@ FILE *open_temp(const char *oname, uint stream)
 
     (void)parse_file(oname, dir, NULL);
 
-    char tempfile[PATH_MAX];
-    int nbytes = snprintf(tempfile, sizeof(tempfile), "%s%s", dir, "_teco_XXXXXX");
-    int fd = mkstemp(tempfile);
+    int fd = -1;
 
-    if (fd == -1)
+#if     defined(O_TMPFILE)
+
+    // If possible, create an anonymous file in the same directory, which
+    // will be given a name when it's closed, and which will simply vanish
+    // if it's killed, or if we crash before it's closed. Naming the file
+    // requires /proc, so if that isn't mounted, use a named temp file.
+
+    if (access("/proc/self/fd", F_OK) == 0)
     {
-        throw(E_ERR, tempfile);         // General error
+        fd = open(dir[0] == NUL ? "." : dir, O_TMPFILE | O_RDWR,
+                  S_IRUSR | S_IWUSR);
     }
 
-    fchmod(fd, statbuf.st_mode);  // Use same permissions as old file
+    ofile->anon = (fd != -1);
 
-    ofile->temp = alloc_mem((uint_t)(uint)nbytes + 1);
+#endif
 
-    strcpy(ofile->temp, tempfile);
+    if (fd == -1)                       // Use a named temp file if necessary
+    {
+        char tempfile[PATH_MAX];
+        int nbytes = snprintf(tempfile, sizeof(tempfile), "%s%s", dir,
+                              "_teco_XXXXXX");
+
+        if ((fd = mkstemp(tempfile)) == -1)
+        {
+            throw(E_ERR, tempfile);     // General error
+        }
+
+        ofile->temp = alloc_mem((uint_t)(uint)nbytes + 1);
+
+        strcpy(ofile->temp, tempfile);
+    }
+
+    fchmod(fd, statbuf.st_mode);        // Use same permissions as old file
+
+#if     defined(FALLOC_FL_KEEP_SIZE)
+
+    // Preallocate space for the file, based on the larger of the file we're
+    // superseding and the current edit buffer, so that large files aren't
+    // fragmented as they're written. Any excess is trimmed when we close.
+
+    off_t size = statbuf.st_size;
+
+    if (size < (off_t)t->Z)
+    {
+        size = (off_t)t->Z;
+    }
+
+    if (size != 0)
+    {
+        (void)fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)0, size);
+    }
+
+#endif
 
     return fdopen(fd, "w+");
 }
@@ -361,10 +467,16 @@ void read_memory(char *p, uint len)
 
 ///
 ///  @brief    Rename output file. This is system-dependent, because on Linux
-///            we use a temporary name when opening the file, and we will need
-///            to delete the original file and then rename the temporary file.
-///            If a backup was requested, we will just rename the original file
-///            instead of deleting it.
+///            we use a temporary (possibly anonymous) file when opening the
+///            file, which we rename to replace the original file, so that the
+///            original is never missing. If a backup was requested, we first
+///            rename the original file. An anonymous file is first linked to a
+///            temporary name, so that the new data is never lost if something
+///            fails.
+///
+///            Before doing any of that, we flush the file to disk as required
+///            by E3&512 (file data only) or E3&1024 (file and directory), so
+///            that the new file and the backup survive a system crash.
 ///
 ///  @returns  Nothing.
 ///
@@ -374,11 +486,25 @@ void rename_output(struct ofile *ofile)
 {
     assert(ofile != NULL);              // Error if no output file
 
-    if (ofile->temp == NULL)            // Nothing to do if no temp. file
+    if (ofile->fp == NULL)              // Nothing to do if no output file
     {
         return;
     }
 
+    sync_output(ofile);
+
+    if (ofile->temp == NULL && !ofile->anon) // Nothing to rename?
+    {
+        sync_dir(ofile->name);          // We still need new directory entry
+
+        return;
+    }
+
+    if (ofile->anon)                    // Give anonymous file a name
+    {
+        link_temp(ofile);
+    }
+
     if (ofile->backup)
     {
         char saved_name[strlen(ofile->name) + 1 + 1];
@@ -392,17 +518,16 @@ void rename_output(struct ofile *ofile)
             throw(E_ERR, ofile->name);  // General error
         }
     }
-    else if (remove(ofile->name) != 0)
-    {
-        throw(E_ERR, ofile->name);      // General error
-    }
 
-    // Rename temp. file name to actual name
+    // Rename temp. file name to actual name. Note that this replaces any
+    // existing file, so we don't need to delete it first.
 
     if (rename(ofile->temp, ofile->name) != 0)
     {
         throw(E_ERR, ofile->name);      // General error
     }
+
+    sync_dir(ofile->name);
 }
 
 
@@ -446,6 +571,94 @@ bool set_wild(const char *filename)
 }
 
 
+///
+///  @brief    Flush directory containing output file to disk, if E3&1024 is
+///            set. This ensures that the new name (and any backup name) is
+///            as permanent as the data in the file.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void sync_dir(const char *name)
+{
+    assert(name != NULL);
+
+    if (!f.e3.fsync)
+    {
+        return;
+    }
+
+    char dir[strlen(name) + 1];
+
+    (void)parse_file(name, dir, NULL);
+
+    int fd = open(dir[0] == NUL ? "." : dir, O_RDONLY | O_DIRECTORY);
+
+    if (fd == -1)
+    {
+        throw(E_ERR, name);             // General error
+    }
+
+    if (fsync(fd) != 0)
+    {
+        close(fd);
+
+        throw(E_ERR, name);             // General error
+    }
+
+    close(fd);
+}
+
+
+///
+///  @brief    Flush output file to disk as required by E3 flag, after trimming
+///            any space we preallocated for it but didn't use.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void sync_output(struct ofile *ofile)
+{
+    assert(ofile != NULL);
+    assert(ofile->fp != NULL);
+
+    if (fflush(ofile->fp) != 0)
+    {
+        throw(E_ERR, ofile->name);      // General error
+    }
+
+    int fd = fileno(ofile->fp);
+
+#if     defined(FALLOC_FL_KEEP_SIZE)
+
+    struct stat statbuf;
+
+    if ((ofile->temp != NULL || ofile->anon) && fstat(fd, &statbuf) == 0)
+    {
+        (void)ftruncate(fd, statbuf.st_size);
+    }
+
+#endif
+
+    if (f.e3.fsync)
+    {
+        if (fsync(fd) != 0)
+        {
+            throw(E_ERR, ofile->name);  // General error
+        }
+    }
+    else if (f.e3.datasync)
+    {
+        if (fdatasync(fd) != 0)
+        {
+            throw(E_ERR, ofile->name);  // General error
+        }
+    }
+}
+
+
 ///
 ///  @brief    Write EB or EW file to memory file.
 ///
@@ -164,6 +164,8 @@ void exec_E1(struct cmd *cmd)
     f.e1.dollar  = e1.dollar;
     f.e1.insert  = e1.insert;
     f.e1.percent = e1.percent;
+    f.e1.regex   = e1.regex;
+    f.e1.trigram = e1.trigram;
 
 #if     defined(DEBUG)
 
@@ -219,14 +221,17 @@ void exec_E3(struct cmd *cmd)
 
     // Only allow defined bits to be set or cleared
 
-    f.e3.nopage  = e3.nopage;
-    f.e3.smart   = e3.smart;
-    f.e3.CR_in   = e3.CR_in;
-    f.e3.CR_out  = e3.CR_out;
-    f.e3.noin    = e3.noin;
-    f.e3.noout   = e3.noout;
-    f.e3.keepNUL = e3.keepNUL;
-    f.e3.CR_type = e3.CR_type;
+    f.e3.nopage   = e3.nopage;
+    f.e3.smart    = e3.smart;
+    f.e3.CR_in    = e3.CR_in;
+    f.e3.CR_out   = e3.CR_out;
+    f.e3.noin     = e3.noin;
+    f.e3.noout    = e3.noout;
+    f.e3.bgsave   = e3.bgsave;
+    f.e3.keepNUL  = e3.keepNUL;
+    f.e3.CR_type  = e3.CR_type;
+    f.e3.datasync = e3.datasync;
+    f.e3.fsync    = e3.fsync;
 }
 
 
@@ -250,6 +255,7 @@ void exec_E4(struct cmd *cmd)
     f.e4.invert = e4.invert;
     f.e4.fence  = e4.fence;
     f.e4.status = e4.status;
+    f.e4.redraw = e4.redraw;
 
     if (changes)                        // Any changes?
     {
@@ -475,12 +481,19 @@ bool scan_EJ(struct cmd *cmd)
         n = (int)cmd->n_arg;            // Get whatever operand we can
     }
 
-    n = teco_env(n, cmd->colon);        // Do the system-dependent part
+    // Do the system-dependent part
 
-    push_x((int_t)n, X_OPERAND);        // Now return the result
+    n = teco_env(n, cmd->m_arg, cmd->m_set, cmd->colon);
 
     cmd->colon = false;
 
+    if (cmd->m_set)                     // m,nEJ just sets a value
+    {
+        return false;
+    }
+
+    push_x((int_t)n, X_OPERAND);        // Now return the result
+
     return true;
 }
 
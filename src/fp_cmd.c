@@ -0,0 +1,508 @@
+///
+///  @file    fp_cmd.c
+///  @brief   Execute FP command.
+///
+///  @copyright 2022 Franklin P. Johnston / Nowwith Treble Software
+///
+///  Permission is hereby granted, free of charge, to any person obtaining a
+///  copy of this software and associated documentation files (the "Software"),
+///  to deal in the Software without restriction, including without limitation
+///  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///  and/or sell copies of the Software, and to permit persons to whom the
+///  Software is furnished to do so, subject to the following conditions:
+///
+///  The above copyright notice and this permission notice shall be included in
+///  all copies or substantial portions of the Software.
+///
+///  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIA-
+///  BILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///  THE SOFTWARE.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include "teco.h"
+#include "ascii.h"
+#include "editbuf.h"
+#include "errcodes.h"
+#include "estack.h"
+#include "exec.h"
+#include "term.h"
+
+
+#define FP_SIZE         (KB * 64)       ///< Size of blocks read from filter
+
+///  @struct  filter
+///  @brief   State of filter process.
+
+struct filter
+{
+    pid_t pid;                      ///< Process ID of filter
+    int in;                         ///< Write end of filter's input pipe
+    int out;                        ///< Read end of filter's output pipe
+    int err;                        ///< Read end of filter's error pipe
+};
+
+
+// Local functions
+
+static void close_fd(int *fd);
+
+static bool read_err(int fd, tbuffer *err);
+
+static bool run_filter(struct filter *filter, int_t len, tbuffer *err,
+                       uint_t *nbytes);
+
+static bool start_filter(struct filter *filter, const char *syscmd);
+
+
+///
+///  @brief    Close file descriptor, if it's open.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void close_fd(int *fd)
+{
+    assert(fd != NULL);
+
+    if (*fd != -1)
+    {
+        close(*fd);
+
+        *fd = -1;
+    }
+}
+
+
+///
+///  @brief    Execute FP command: filter text in edit buffer through a system
+///            command. The text is written to the standard input of the
+///            command, and the text is replaced by the command's standard
+///            output. If the command fails, then the edit buffer is left
+///            unchanged.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void exec_FP(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    if (cmd->text1.len == 0)            // Any command string?
+    {
+        return;                         // No
+    }
+
+    int_t m, n;
+
+    if (cmd->h)                         // HFP
+    {
+        m = t->B;
+        n = t->Z;
+    }
+    else if (cmd->m_set)                // m,nFP
+    {
+        m = cmd->m_arg;
+        n = cmd->n_arg;
+
+        if (m > n)                      // Swap m and n if needed
+        {
+            m ^= n;
+            n ^= m;
+            m ^= n;
+        }
+
+        if (m < t->B || m > t->Z || n < t->B || n > t->Z)
+        {
+            throw(E_POP, "FP");         // Pointer off page
+        }
+    }
+    else                                // nFP
+    {
+        int_t len = len_edit(cmd->n_arg);
+
+        if (len < 0)
+        {
+            m = t->dot + len;
+            n = t->dot;
+        }
+        else
+        {
+            m = t->dot;
+            n = t->dot + len;
+        }
+    }
+
+    tstring buf = build_string(cmd->text1.data, cmd->text1.len);
+    char syscmd[buf.len + 1];
+
+    memcpy(syscmd, buf.data, (size_t)buf.len);
+
+    syscmd[buf.len] = NUL;
+
+    struct filter filter;
+
+    if (!start_filter(&filter, syscmd))
+    {
+        if (cmd->colon)
+        {
+            push_x(FAILURE, X_OPERAND);
+
+            return;
+        }
+
+        throw(E_ERR, syscmd);           // General error
+    }
+
+    int_t saved_dot = t->dot;
+    tbuffer err = { .data = NULL, .size = 0, .len = 0, .pos = 0 };
+    uint_t nbytes = 0;
+
+    set_dot(m);
+
+    // The output of the filter is inserted at dot, which means that the
+    // text we're filtering always follows dot.
+
+    bool success = run_filter(&filter, n - m, &err, &nbytes);
+
+    if (success)
+    {
+        delete_edit(n - m);             // Delete original text
+
+        last_len = nbytes;
+    }
+    else
+    {
+        delete_edit(-(int_t)nbytes);    // Delete any output we inserted
+
+        set_dot(saved_dot);
+    }
+
+    if (err.len != 0)                   // Type anything filter complained of
+    {
+        tprint("%.*s", (int)err.len, err.data);
+    }
+
+    free_mem(&err.data);
+
+    if (cmd->colon)
+    {
+        push_x(success ? SUCCESS : FAILURE, X_OPERAND);
+    }
+    else if (!success)
+    {
+        throw(E_SYS, syscmd);           // System command failed
+    }
+}
+
+
+///
+///  @brief    Read error output from filter.
+///
+///  @returns  true if filter may have more output, false if we hit EOF.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool read_err(int fd, tbuffer *err)
+{
+    assert(err != NULL);
+
+    if (err->data == NULL)
+    {
+        *err = alloc_tbuf(KB);
+    }
+    else if (err->len == err->size)
+    {
+        err->data  = expand_mem(err->data, err->size, err->size);
+        err->size *= 2;
+    }
+
+    ssize_t nbytes = read(fd, err->data + err->len,
+                          (size_t)(err->size - err->len));
+
+    if (nbytes > 0)
+    {
+        err->len += (uint_t)nbytes;
+
+        return true;
+    }
+
+    return (nbytes == -1 && (errno == EINTR || errno == EAGAIN));
+}
+
+
+///
+///  @brief    Pass text to filter and read its output. We use non-blocking
+///            pipes and poll() so that neither we nor the filter can block
+///            waiting for the other, regardless of how much the filter reads
+///            before it starts writing. Text is written directly from the
+///            edit buffer, and the output is inserted at dot as it's read.
+///
+///  @returns  true if filter succeeded, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool run_filter(struct filter *filter, int_t len, tbuffer *err,
+                       uint_t *nbytes)
+{
+    assert(filter != NULL);
+    assert(err != NULL);
+    assert(nbytes != NULL);
+
+    struct sigaction sa = { .sa_handler = SIG_IGN };
+    struct sigaction saved;
+
+    // Ignore SIGPIPE, in case the filter exits without reading all its input.
+
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPIPE, &sa, &saved);
+
+    bool ok = true;
+    int_t written = 0;
+    char block[FP_SIZE];
+
+    if (len == 0)
+    {
+        close_fd(&filter->in);
+    }
+
+    while (filter->out != -1 || filter->err != -1)
+    {
+        struct pollfd pfds[3];
+        nfds_t nfds = 0;
+
+        if (filter->in != -1)
+        {
+            pfds[nfds].fd       = filter->in;
+            pfds[nfds++].events = POLLOUT;
+        }
+
+        if (filter->out != -1)
+        {
+            pfds[nfds].fd       = filter->out;
+            pfds[nfds++].events = POLLIN;
+        }
+
+        if (filter->err != -1)
+        {
+            pfds[nfds].fd       = filter->err;
+            pfds[nfds++].events = POLLIN;
+        }
+
+        if (poll(pfds, nfds, -1) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            ok = false;
+
+            break;
+        }
+
+        for (nfds_t i = 0; i < nfds; ++i)
+        {
+            if (pfds[i].revents == 0)
+            {
+                continue;
+            }
+
+            if (pfds[i].fd == filter->in)
+            {
+                int_t avail;
+                const char *p = span_edit(&avail);
+
+                assert(avail >= len);
+
+                ssize_t n = write(filter->in, p + written,
+                                  (size_t)(len - written));
+
+                if (n > 0)
+                {
+                    written += n;
+                }
+                else if (n == -1 && errno != EINTR && errno != EAGAIN)
+                {
+                    written = len;      // Filter isn't reading any more
+                }
+
+                if (written == len)
+                {
+                    close_fd(&filter->in);
+                }
+            }
+            else if (pfds[i].fd == filter->out)
+            {
+                ssize_t n = read(filter->out, block, sizeof(block));
+
+                if (n > 0)
+                {
+                    if (!insert_edit(block, (size_t)n))
+                    {
+                        ok = false;
+                        close_fd(&filter->in);
+                        close_fd(&filter->out);
+                        close_fd(&filter->err);
+
+                        break;
+                    }
+
+                    *nbytes += (uint_t)n;
+                }
+                else if (n == 0 || (errno != EINTR && errno != EAGAIN))
+                {
+                    close_fd(&filter->out);
+                }
+            }
+            else if (!read_err(filter->err, err))
+            {
+                close_fd(&filter->err);
+            }
+        }
+    }
+
+    close_fd(&filter->in);
+
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(filter->pid, &status, 0)) == -1 && errno == EINTR)
+    {
+        ;
+    }
+
+    sigaction(SIGPIPE, &saved, NULL);
+
+    if (pid == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+    {
+        return false;
+    }
+
+    return ok;
+}
+
+
+///
+///  @brief    Start filter process, using the shell to execute the command,
+///            with pipes for its standard input, output, and error.
+///
+///  @returns  true if filter started, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool start_filter(struct filter *filter, const char *syscmd)
+{
+    assert(filter != NULL);
+    assert(syscmd != NULL);
+
+    int in[2], out[2], err[2];
+
+    if (pipe(in) == -1)
+    {
+        return false;
+    }
+    else if (pipe(out) == -1)
+    {
+        close(in[0]);
+        close(in[1]);
+
+        return false;
+    }
+    else if (pipe(err) == -1)
+    {
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+
+        return false;
+    }
+
+    flush_term();
+    flush_log();
+    fflush(NULL);                       // Don't duplicate any buffered output
+
+    if ((filter->pid = fork()) == 0)    // Child process
+    {
+        if (dup2(in[0], STDIN_FILENO) == -1
+            || dup2(out[1], STDOUT_FILENO) == -1
+            || dup2(err[1], STDERR_FILENO) == -1)
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        close(in[0]);
+        close(in[1]);
+        close(out[0]);
+        close(out[1]);
+        close(err[0]);
+        close(err[1]);
+
+        execl("/bin/sh", "sh", "-c", syscmd, (char *)NULL);
+
+        _exit(127);                     // Same status as shell uses
+    }
+
+    close(in[0]);
+    close(out[1]);
+    close(err[1]);
+
+    if (filter->pid == -1)
+    {
+        close(in[1]);
+        close(out[0]);
+        close(err[0]);
+
+        return false;
+    }
+
+    filter->in  = in[1];
+    filter->out = out[0];
+    filter->err = err[0];
+
+    fcntl(filter->in,  F_SETFL, O_NONBLOCK);
+    fcntl(filter->out, F_SETFL, O_NONBLOCK);
+    fcntl(filter->err, F_SETFL, O_NONBLOCK);
+
+    return true;
+}
+
+
+///
+///  @brief    Scan FP command.
+///
+///  @returns  false (command is not an operand or operator).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool scan_FP(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    default_n(cmd, (int_t)1);           // FP => 1FP
+    reject_neg_m(cmd->m_set, cmd->m_arg);
+    reject_dcolon(cmd->dcolon);
+    scan_texts(cmd, 1, ESC);
+
+    return false;
+}
@@ -26,6 +26,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,6 +38,7 @@
 #include "eflags.h"
 #include "file.h"
 #include "page.h"
+#include "search.h"
 #include "term.h"
 
 
@@ -87,6 +89,12 @@
 
 #define EDIT_MIN    (KB)            ///< Minimum size is 1 KB
 
+#define DIRTY_MAX   ((int_t)KB * 4) ///< Max. change we track for display
+
+#define WORD_ONES   ((uint_t)-1 / UCHAR_MAX) ///< 0x01 in each byte of word
+
+#define WORD_HIGH   (WORD_ONES * 0x80)  ///< 0x80 in each byte of word
+
 
 ///  @var     eb
 ///
@@ -100,6 +108,9 @@ static struct
     uint_t gap;                 ///< No. of bytes in gap
     const uint_t min;           ///< Minimum buffer size (fixed)
     const uint_t max;           ///< Maximum buffer size (fixed)
+    int_t nlines;               ///< Total no. of line delimiters
+    int_t linepos;              ///< Position at which lineno was counted
+    int_t lineno;               ///< No. of line delimiters before linepos
     struct edit t;              ///< Read/write copies of public variables
 } eb =
 {
@@ -109,6 +120,9 @@ static struct
     .left   = 0,
     .right  = 0,
     .gap    = EDIT_INIT,
+    .nlines  = 0,
+    .linepos = 0,
+    .lineno  = 0,
     .t =
     {
         .size  = EDIT_INIT,
@@ -125,9 +139,19 @@ static struct
 
 const struct edit *t = &eb.t;       ///< Read-only pointers to public variables
 
+///  @var     dirty
+///
+///  @brief   Range of text changed since last display update
+
+static struct dirty dirty = { .start = -1, .end = -1, .delta = 0, .nlines = 0 };
+
 
 // Local functions
 
+static bool convert_case(uchar *p, uint_t nbytes, bool lower);
+
+static int_t count_lines(int_t start, int_t end);
+
 static int_t count_prev(uint_t nlines);
 
 static int_t count_next(uint_t nlines);
@@ -144,6 +168,8 @@ static void inc_dot(void);
 
 static void last_dot(void);
 
+static void mark_change(int_t pos, int_t ndelete, int_t ninsert, int_t nlines);
+
 static void reset_edit(void);
 
 static void shift_left(uint_t nbytes);
@@ -162,19 +188,7 @@ static bool start_insert(uint_t size);
 
 int_t after_dot(void)
 {
-    int_t nlines = 0;
-
-    for (int_t pos = 0; pos < eb.t.Z; ++pos)
-    {
-        int c = find_edit(pos);
-
-        if (c != EOF && isdelim(c))
-        {
-            ++nlines;
-        }
-    }
-
-    return nlines;
+    return eb.nlines - before_dot();
 }
 
 
@@ -314,19 +328,115 @@ bool append_edit(struct ifile *ifile, uint nlines)
 
 int_t before_dot(void)
 {
-    int_t nlines = 0;
+    // We keep a count of the line delimiters preceding some position in the
+    // buffer, so we only need to count the ones between that position and dot
+    // (or between dot and the start or end of the buffer, if that's closer).
 
-    for (int_t pos = -eb.t.dot; pos < 0; ++pos)
-    {
-        int c = find_edit(pos);
+    int_t dot = eb.t.dot;
 
-        if (c != EOF && isdelim(c))
+    if (dot >= eb.linepos)
+    {
+        if (eb.t.Z - dot < dot - eb.linepos)
+        {
+            eb.lineno = eb.nlines - count_lines(dot, eb.t.Z);
+        }
+        else
+        {
+            eb.lineno += count_lines(eb.linepos, dot);
+        }
+    }
+    else
+    {
+        if (dot < eb.linepos - dot)
+        {
+            eb.lineno = count_lines((int_t)0, dot);
+        }
+        else
         {
-            ++nlines;
+            eb.lineno -= count_lines(dot, eb.linepos);
         }
     }
 
-    return nlines;
+    eb.linepos = dot;
+
+    return eb.lineno;
+}
+
+
+///
+///  @brief    Get the contiguous block of text (either the text before the gap,
+///            or the text after it) that contains a buffer position. This lets
+///            callers scan the buffer directly, without reading each character
+///            with read_edit(). The block remains valid until the next change
+///            to the edit buffer.
+///
+///  @returns  Pointer that can be indexed by absolute buffer positions from
+///            start up to (but not including) end.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+const char *block_edit(int_t pos, int_t *start, int_t *end)
+{
+    assert(start != NULL);
+    assert(end != NULL);
+
+    if (pos < (int_t)eb.left)
+    {
+        *start = 0;
+        *end   = (int_t)eb.left;
+
+        return (const char *)eb.buf;
+    }
+    else
+    {
+        *start = (int_t)eb.left;
+        *end   = (int_t)(eb.left + eb.right);
+
+        return (const char *)eb.buf + eb.gap;
+    }
+}
+
+
+///
+///  @brief    Convert the case of the text between two positions, by working
+///            directly on the text on either side of the gap. The change is
+///            recorded once for the whole range, and dot is not moved.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void case_edit(int_t start, int_t end, bool lower)
+{
+    assert(eb.buf != NULL);             // Error if no edit buffer
+    assert(start >= eb.t.B && start <= end && end <= eb.t.Z);
+
+    uint_t low  = (uint_t)start;
+    uint_t high = (uint_t)end;
+    bool changed = false;
+
+    if (low < eb.left)                  // Convert text before gap
+    {
+        uint_t last = (high < eb.left) ? high : eb.left;
+
+        changed |= convert_case(eb.buf + low, last - low, lower);
+
+        low = last;
+    }
+
+    if (low < high)                     // Convert text after gap
+    {
+        changed |= convert_case(eb.buf + eb.gap + low, high - low, lower);
+    }
+
+    if (changed)
+    {
+        mark_change(start, end - start, end - start, (int_t)0);
+
+        eb.t.lastc = find_edit(-1);
+        eb.t.c     = find_edit(0);
+        eb.t.nextc = find_edit(1);
+    }
 }
 
 
@@ -346,9 +456,105 @@ void change_dot(int c)
         i += eb.gap;
     }
 
+    int old = eb.buf[i];
+
     eb.buf[i] = eb.t.c = (uchar)c;
 
-    f.e0.window = true;                 // Window refresh needed
+    mark_change(eb.t.dot, (int_t)1, (int_t)1,
+               (int_t)(isdelim(c) ? 1 : 0) - (int_t)(isdelim(old) ? 1 : 0));
+}
+
+
+///
+///  @brief    Convert the case of the letters in a block of text. We work a word
+///            at a time, using the low seven bits of each byte to find the ones
+///            between A and Z (or a and z) without any carries between bytes,
+///            and then flip bit 5 of each of them. Only ASCII letters change,
+///            as with the C library functions in the "C" locale.
+///
+///  @returns  true if any letters were converted, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool convert_case(uchar *p, uint_t nbytes, bool lower)
+{
+    assert(p != NULL);
+
+    int first = lower ? 'A' : 'a';      // Range of letters to convert
+    int last  = lower ? 'Z' : 'z';
+    uint_t above_first = WORD_ONES * (uint_t)(0x80 - first);
+    uint_t above_last  = WORD_ONES * (uint_t)(0x7f - last);
+    uint_t changed = 0;
+    uint_t i = 0;
+
+    for (; i + sizeof(uint_t) <= nbytes; i += sizeof(uint_t))
+    {
+        uint_t word;
+
+        memcpy(&word, p + i, sizeof(word));
+
+        uint_t low7 = word & ~WORD_HIGH;
+        uint_t mask = (low7 + above_first) & ~(low7 + above_last) & ~word;
+
+        mask = (mask & WORD_HIGH) >> 2; // 0x20 for each letter
+
+        if (mask != 0)
+        {
+            word ^= mask;
+
+            memcpy(p + i, &word, sizeof(word));
+
+            changed |= mask;
+        }
+    }
+
+    for (; i < nbytes; ++i)             // Convert any bytes left over
+    {
+        if (p[i] >= first && p[i] <= last)
+        {
+            p[i] ^= 0x20;
+
+            changed = 1;
+        }
+    }
+
+    return (changed != 0);
+}
+
+
+///
+///  @brief    Count line delimiters between two absolute positions.
+///
+///  @returns  No. of line delimiters.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t count_lines(int_t start, int_t end)
+{
+    assert(start >= 0 && start <= end && end <= eb.t.Z);
+
+    int_t nlines = 0;
+    uint_t split = eb.left;             // Last position before gap
+
+    // Count the part that's on the left side of the gap, then the part that's
+    // on the right side, so that we don't have to check each position.
+
+    for (uint_t i = (uint_t)start; i < (uint_t)end && i < split; ++i)
+    {
+        nlines += isdelim(eb.buf[i]) ? 1 : 0;
+    }
+
+    if ((uint_t)start < split)
+    {
+        start = (int_t)split;
+    }
+
+    for (uint_t i = (uint_t)start; i < (uint_t)end; ++i)
+    {
+        nlines += isdelim(eb.buf[i + eb.gap]) ? 1 : 0;
+    }
+
+    return nlines;
 }
 
 
@@ -483,12 +689,19 @@ void delete_edit(int_t nbytes)
             shift_left((uint_t)eb.t.dot - eb.left);
         }
 
+        int_t nlines = 0;
+
         if (nbytes < 0)                 // Deleting backwards in [left]
         {
             nbytes = -nbytes;
 
             assert((uint_t)nbytes <= eb.left);
 
+            for (uint_t i = eb.left - (uint_t)nbytes; i < eb.left; ++i)
+            {
+                nlines -= isdelim(eb.buf[i]) ? 1 : 0;
+            }
+
             eb.left -= (uint_t)nbytes;
             eb.t.dot -= nbytes;         // Backwards delete affects dot
 
@@ -498,6 +711,13 @@ void delete_edit(int_t nbytes)
         {
             assert((uint_t)nbytes <= eb.right);
 
+            uint_t start = eb.t.size - eb.right;
+
+            for (uint_t i = start; i < start + (uint_t)nbytes; ++i)
+            {
+                nlines -= isdelim(eb.buf[i]) ? 1 : 0;
+            }
+
             eb.right -= (uint_t)nbytes;
 
             eb.t.c    = find_edit(0);
@@ -510,7 +730,7 @@ void delete_edit(int_t nbytes)
         eb.gap += (uint_t)nbytes;       // Increase the gap
         eb.t.Z -= nbytes;               //  and decrease the total
 
-        f.e0.window = true;             // Window refresh needed
+        mark_change(eb.t.dot, nbytes, (int_t)0, nlines);
     }
 }
 
@@ -565,6 +785,15 @@ static void finish_insert(uint_t nbytes)
 {
     assert(nbytes != 0);
 
+    int_t nlines = 0;
+
+    for (uint_t i = eb.left; i < eb.left + nbytes; ++i)
+    {
+        nlines += isdelim(eb.buf[i]) ? 1 : 0;
+    }
+
+    mark_change(eb.t.dot, (int_t)0, (int_t)nbytes, nlines);
+
     // Now fix up some variables
 
     eb.left  += nbytes;
@@ -593,8 +822,6 @@ static void finish_insert(uint_t nbytes)
     {
         set_page(1);
     }
-
-    f.e0.window = true;                 // Window refresh needed
 }
 
 
@@ -622,6 +849,25 @@ static void first_dot(void)
 }
 
 
+///
+///  @brief    Get range of text changed since the last call, and reset it.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void get_dirty(struct dirty *change)
+{
+    assert(change != NULL);
+
+    *change = dirty;
+
+    dirty.start  = dirty.end = -1;
+    dirty.delta  = 0;
+    dirty.nlines = 0;
+}
+
+
 ///
 ///  @brief    Increment dot by 1.
 ///
@@ -760,6 +1006,94 @@ int_t len_edit(int_t n)
 }
 
 
+///
+///  @brief    Record a change to the edit buffer. The change replaced ndelete
+///            characters at pos with ninsert characters, and changed the no.
+///            of line terminators by nlines.
+///
+///            We update the line counts, and the range of text that the
+///            display will need to repaint. Changes are merged with any
+///            previous ones that haven't been displayed yet. If the change is
+///            too big to track, we just ask for the whole window to be
+///            repainted.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void mark_change(int_t pos, int_t ndelete, int_t ninsert, int_t nlines)
+{
+    eb.nlines += nlines;
+
+    mark_column(pos, ndelete, ninsert);
+    mark_search(pos, ndelete, ninsert);
+    mark_syntax(pos);
+
+    f.e0.cursor = true;                 // Cursor refresh needed
+
+    if (eb.linepos >= pos + ndelete)    // Change preceded counted position?
+    {
+        eb.linepos += ninsert - ndelete;
+        eb.lineno  += nlines;
+    }
+    else if (eb.linepos > pos)          // Change included counted position
+    {
+        eb.linepos = 0;
+        eb.lineno  = 0;
+    }
+
+    if (ndelete > DIRTY_MAX || ninsert > DIRTY_MAX)
+    {
+        f.e0.window = true;             // Window refresh needed
+
+        return;
+    }
+
+    int_t end = pos + ninsert;          // End of change
+
+    if (dirty.start == -1)
+    {
+        dirty.start = pos;
+        dirty.end   = end;
+    }
+    else
+    {
+        // Map previous range to new positions, then merge the two ranges.
+
+        if (dirty.start > pos + ndelete)
+        {
+            dirty.start += ninsert - ndelete;
+        }
+        else if (dirty.start > pos)
+        {
+            dirty.start = pos;
+        }
+
+        if (dirty.end >= pos + ndelete)
+        {
+            dirty.end += ninsert - ndelete;
+        }
+        else if (dirty.end > pos)
+        {
+            dirty.end = end;
+        }
+
+        if (dirty.start > pos)
+        {
+            dirty.start = pos;
+        }
+
+        if (dirty.end < end)
+        {
+            dirty.end = end;
+        }
+    }
+
+    dirty.delta  += ninsert - ndelete;
+    dirty.nlines += nlines;
+}
+
+
 ///
 ///  @brief    Move dot to a relative position.
 ///
@@ -798,6 +1132,89 @@ int read_edit(int_t pos)
 }
 
 
+///
+///  @brief    Replace a range of text in the edit buffer with new text, as a
+///            single change. This is equivalent to deleting the old text and
+///            inserting the new text, but the buffer is only shifted once, and
+///            nothing is changed if there isn't enough memory for the result.
+///            Dot is left at the end of the new text.
+///
+///  @returns  true if replacement succeeded, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool replace_edit(int_t start, int_t end, const char *buf, uint_t nbytes)
+{
+    assert(buf != NULL || nbytes == 0);
+    assert(eb.buf != NULL);             // Error if no edit buffer
+    assert(start >= eb.t.B && start <= end && end <= eb.t.Z);
+
+    uint_t ndelete = (uint_t)(end - start);
+
+    // Make sure new text fits in the space we have, allowing for the text it
+    // replaces. If not, increase by 50% (see start_insert()).
+
+    while (eb.gap + ndelete < nbytes)
+    {
+        uint_t size = (eb.t.size * 3) / 2;
+
+        if (size_edit(size) == 0)
+        {
+            return false;
+        }
+
+        print_size(size);
+    }
+
+    if ((uint_t)start < eb.left)        // Move gap to start of old text
+    {
+        shift_right(eb.left - (uint_t)start);
+    }
+    else if ((uint_t)start > eb.left)
+    {
+        shift_left((uint_t)start - eb.left);
+    }
+
+    int_t nlines = 0;
+    uint_t old = eb.t.size - eb.right;
+
+    for (uint_t i = old; i < old + ndelete; ++i)
+    {
+        nlines -= isdelim(eb.buf[i]) ? 1 : 0;
+    }
+
+    eb.right -= ndelete;
+    eb.gap   += ndelete;
+
+    if (nbytes != 0)
+    {
+        memcpy(eb.buf + eb.left, buf, (size_t)nbytes);
+    }
+
+    for (uint_t i = eb.left; i < eb.left + nbytes; ++i)
+    {
+        nlines += isdelim(eb.buf[i]) ? 1 : 0;
+    }
+
+    mark_change(start, (int_t)ndelete, (int_t)nbytes, nlines);
+
+    eb.left  += nbytes;
+    eb.gap   -= nbytes;
+    eb.t.Z   += (int_t)nbytes - (int_t)ndelete;
+    eb.t.dot  = start + (int_t)nbytes;
+
+    eb.t.lastc = find_edit(-1);
+    eb.t.c     = find_edit(0);
+    eb.t.nextc = find_edit(1);
+
+    eb.t.pos  = eb.t.dot - count_prev(0);
+    eb.t.len  = count_next(1) - eb.t.dot;
+    eb.t.len += eb.t.pos;
+
+    return true;
+}
+
+
 ///
 ///  @brief    Reset buffer variables to initial conditions.
 ///
@@ -807,10 +1224,18 @@ int read_edit(int_t pos)
 
 static void reset_edit(void)
 {
+    mark_column((int_t)0, eb.t.Z, (int_t)0);
+    mark_search((int_t)0, eb.t.Z, (int_t)0);
+    mark_syntax((int_t)0);
+
     eb.left     = 0;
     eb.right    = 0;
     eb.gap      = eb.t.size;
 
+    eb.nlines   = 0;
+    eb.linepos  = 0;
+    eb.lineno   = 0;
+
     eb.t.Z      = 0;
     eb.t.dot    = 0;
     eb.t.nextc  = EOF;
@@ -967,6 +1392,36 @@ uint_t size_edit(uint_t size)
 }
 
 
+///
+///  @brief    Get pointer to the text following dot. The gap is moved to dot,
+///            so that the text is contiguous. The pointer is only valid until
+///            the next change to the edit buffer.
+///
+///  @returns  Pointer to text following dot.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+const char *span_edit(int_t *nbytes)
+{
+    assert(nbytes != NULL);
+
+    uint_t dot = (uint_t)eb.t.dot;
+
+    if (dot < eb.left)
+    {
+        shift_right(eb.left - dot);
+    }
+    else if (dot > eb.left)
+    {
+        shift_left(dot - eb.left);
+    }
+
+    *nbytes = (int_t)eb.right;
+
+    return (const char *)eb.buf + eb.t.size - eb.right;
+}
+
+
 ///
 ///  @brief    Initialize buffer for adding characters.
 ///
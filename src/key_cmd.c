@@ -53,8 +53,6 @@ char keysize[UCHAR_MAX + 1];        ///< No. of chrs. required to display each k
 
 // Local functions
 
-static int_t count_chrs(int_t pos, int maxcol);
-
 static void exec_down(int key);
 
 static void exec_end(int key);
@@ -97,44 +95,6 @@ int check_key(int c)
 }
 
 
-///
-///  @brief    Count the number of characters required to get to saved column.
-///
-///  @returns  No. of bytes to adjust 'dot'.
-///
-////////////////////////////////////////////////////////////////////////////////
-
-static int_t count_chrs(int_t pos, int maxcol)
-{
-    int col = 0;                        // Current column in line
-    int c;
-
-    while ((c = read_edit(pos)) != EOF)
-    {
-        int width;
-
-        if (c == HT && !w.seeall)
-        {
-            width = TABSIZE - (col % TABSIZE);
-        }
-        else
-        {
-            width = keysize[c];
-        }
-
-        if (isdelim(c) || c == CR || col + width > maxcol)
-        {
-            break;
-        }
-
-        col += width;
-        ++pos;
-    }
-
-    return pos;
-}
-
-
 ///
 ///  @brief    Move cursor down.
 ///
@@ -153,7 +113,7 @@ static void exec_down(int key)
     }
 
     int pos = t->len - t->pos;          // Go to start of next line
-    int_t delta = count_chrs(pos, d.oldcol);
+    int_t delta = find_offset(pos, d.oldcol);
 
     move_dot(delta);
 
@@ -208,7 +168,7 @@ static void exec_end(int key)
 
             if (col < d.maxcol)
             {
-                delta = count_chrs(t->pos, d.maxcol);
+                delta = find_offset(t->pos, d.maxcol);
             }
         }
 
@@ -298,7 +258,7 @@ static void exec_home(int key)
         d.newrow = d.row;
         d.newcol = d.xbias;
 
-        int_t delta = count_chrs(-t->pos, d.newcol);
+        int_t delta = find_offset(-t->pos, d.newcol);
 
         move_dot(delta);
     }
@@ -579,7 +539,7 @@ static void exec_up(int key)
         d.oldcol = d.newcol;
     }
 
-    int_t delta = count_chrs(pos, d.oldcol);
+    int_t delta = find_offset(pos, d.oldcol);
 
     move_dot(delta);
 
@@ -640,6 +600,8 @@ void init_keys(void)
         }
     }
 
+    mark_column((int_t)-1, (int_t)0, (int_t)0); // Widths may have changed
+
     f.e0.window = true;                 // Window refresh needed
 }
 
@@ -712,5 +674,6 @@ void set_tab(int n)
     if (n != TABSIZE)                   // Nothing to do if no change
     {
         set_tabsize(n == 0 ? DEFAULT_TABSIZE : n);
+        mark_column((int_t)-1, (int_t)0, (int_t)0);
     }
 }
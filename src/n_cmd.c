@@ -58,7 +58,9 @@ void exec_N(struct cmd *cmd)
 
 
 ///
-///  @brief    Execute FN command: global search and replace.
+///  @brief    Execute FN command: global search and replace. If double colon-
+///            modified, replace all occurrences in the rest of the file, and
+///            return the no. of replacements.
 ///
 ///  @returns  Nothing.
 ///
@@ -85,6 +87,10 @@ static void exec_search(struct cmd *cmd, bool replace)
     {
         throw(E_ISA);                   // Invalid search argument
     }
+    else if (replace && cmd->dcolon && cmd->n_set && cmd->n_arg < 0)
+    {
+        throw(E_ISA);                   // ::FN only searches forward
+    }
 
     if (!cmd->n_set)                    // Ntext` => 1Ntext`
     {
@@ -116,6 +122,13 @@ static void exec_search(struct cmd *cmd, bool replace)
         s.text_end   = t->Z - t->dot;
     }
 
+    if (replace && cmd->dcolon)         // ::FN => replace all occurrences
+    {
+        push_x(replace_all(&s, cmd->text2.data, cmd->text2.len), X_OPERAND);
+
+        return;
+    }
+
     if (search_loop(&s))
     {
         if (replace)
@@ -25,6 +25,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <assert.h>
+#include <ctype.h>
 #include <getopt.h>
 #include <limits.h>
 #include <stdarg.h>
@@ -53,12 +54,14 @@
 struct options
 {
     const char *args;       ///< --arguments (m,n)
+    const char *batch;      ///< --batch
     bool create;            ///< --create
     bool display;           ///< --display
     const char *execute;    ///< --execute
     bool exit;              ///< --exit
     const char *formfeed;   ///< --formfeed
     const char *initial;    ///< --initial
+    const char *jobs;       ///< --jobs
     char *log;              ///< --log
     const char *memory;     ///< --memory
     char *output;           ///< --output
@@ -81,12 +84,14 @@ struct options
 static struct options options =
 {
     .args     = NULL,
+    .batch    = NULL,
     .create   = true,
     .display  = false,
     .execute  = NULL,
     .exit     = false,
     .formfeed = NULL,
     .initial  = NULL,
+    .jobs     = NULL,
     .log      = NULL,
     .memory   = NULL,
     .output   = NULL,
@@ -179,6 +184,32 @@ void exec_options(int argc, const char * const argv[])
 {
     assert(argv != NULL);               // Error if no argument list
 
+    // If we're processing files in batch mode, then each worker process edits
+    // a single file, executes the macro specified with --execute, and exits.
+    // The parent process waits for all of the workers, and never returns.
+
+    if (options.batch != NULL)
+    {
+        if (options.execute == NULL)
+        {
+            tprint("?--batch option requires --execute option\n");
+
+            exit(EXIT_FAILURE);
+        }
+
+        int njobs = (options.jobs != NULL) ? atoi(options.jobs) : 0;
+        const char *file = exec_batch(options.batch, njobs, options.log);
+
+        if (options.initial)   add_cmd(false, NULL,      options.initial);
+        if (options.formfeed)  add_cmd(false, NULL,      options.formfeed);
+
+        add_cmd(false, "0,128ET EB%s\e Y ", file);
+        add_cmd(true,  NULL, options.execute);
+        add_cmd(false, "EX \e\e");
+
+        return;
+    }
+
     // Process commands that don't open a file for editing.
 
     if (options.initial)   add_cmd(false, NULL,      options.initial);
@@ -381,6 +412,20 @@ void init_options(
 
                 break;
 
+            case OPTION_B:
+                if (optarg != NULL && optarg[0] != '-')
+                {
+                    options.batch = optarg;
+                }
+                else
+                {
+                    options.batch = NULL;
+                }
+
+                options.memory = NULL;
+
+                break;
+
             case OPTION_C:
             case OPTION_c:
                 options.create = (c == 'C') ? true : false;
@@ -454,6 +499,29 @@ void init_options(
 
                 break;
 
+            case OPTION_J:
+                if (optarg != NULL)
+                {
+                    const char *p = optarg;
+
+                    while (isdigit(*p))
+                    {
+                        ++p;
+                    }
+
+                    if (p == optarg || *p != NUL)
+                    {
+                        printf("Invalid value '%s' for --jobs option\n",
+                               optarg);
+
+                        exit(EXIT_FAILURE);
+                    }
+                }
+
+                options.jobs = optarg;
+
+                break;
+
             case OPTION_L:
                 if (optarg != NULL && optarg[0] != '-')
                 {
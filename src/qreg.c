@@ -505,11 +505,21 @@ void print_qreg(int qindex)
 {
     struct qreg *qreg = qregister(qindex);
 
+    if (!f.e3.CR_type)                  // No translation needed for LF
+    {
+        if (qreg->text.len != 0)
+        {
+            type_text(qreg->text.data, qreg->text.len);
+        }
+
+        return;
+    }
+
     for (uint_t i = 0; i < qreg->text.len; ++i)
     {
         int c = qreg->text.data[i];
 
-        if (c == LF && f.e3.CR_type)
+        if (c == LF)
         {
             type_out(CR);
         }
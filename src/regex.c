@@ -0,0 +1,2078 @@
+///
+///  @file    regex.c
+///  @brief   Regular expression search functions.
+///
+///  @copyright 2019-2022 Franklin P. Johnston / Nowwith Treble Software
+///
+///  Permission is hereby granted, free of charge, to any person obtaining a
+///  copy of this software and associated documentation files (the "Software"),
+///  to deal in the Software without restriction, including without limitation
+///  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///  and/or sell copies of the Software, and to permit persons to whom the
+///  Software is furnished to do so, subject to the following conditions:
+///
+///  The above copyright notice and this permission notice shall be included in
+///  all copies or substantial portions of the Software.
+///
+///  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIA-
+///  BILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///  THE SOFTWARE.
+///
+///  A regular expression is parsed into a tree, from which two programs are
+///  generated for a Thompson NFA: one that matches forward, and one that
+///  matches the reversed expression backward. Each program is simulated by a
+///  DFA whose states are built lazily, as they are needed, and cached. Since
+///  each character of the text is examined at most once by each DFA, and no
+///  more than one state is built for each character, searches take time that
+///  is linear in the size of the text, however the expression is written.
+///
+///  A forward search finds the end of the leftmost match with the forward DFA,
+///  then the start of the match with the backward DFA. A backward search does
+///  the reverse. If the expression has any groups, their positions are then
+///  found by simulating the NFA over just the matched text (a Pike VM).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "teco.h"
+#include "ascii.h"
+#include "editbuf.h"
+#include "eflags.h"
+#include "errcodes.h"
+#include "qreg.h"
+#include "search.h"
+
+#define RX_INF          (-1)            ///< Unbounded count or length
+
+#define RX_EOT          (-1)            ///< Pseudo-character for end of text
+
+#define RX_MAXGROUP     9               ///< Last group stored in Q-register
+
+#define RX_MAXPROG      (KB * 8)        ///< Max. instructions in a program
+
+#define RX_MAXREPEAT    1000            ///< Max. count in {m,n}
+
+#define RX_STATES       1024            ///< Max. cached states in a DFA
+
+#define RX_HASH         (RX_STATES * 2) ///< Size of hash table for states
+
+#define RX_POOL         (KB * 64)       ///< Max. instructions in cached states
+
+#define RX_SETSIZE      ((UCHAR_MAX + 1) / CHAR_BIT) ///< Bytes in a set
+
+
+///  @enum   rx_type
+///  @brief  Type of node in parse tree.
+
+enum rx_type
+{
+    RX_EMPTY,                           ///< Empty string
+    RX_SET,                             ///< Any character in a set
+    RX_CAT,                             ///< Left operand, then right operand
+    RX_ALT,                             ///< Left operand, or right operand
+    RX_REPEAT,                          ///< Operand repeated min to max times
+    RX_GROUP,                           ///< Numbered group
+    RX_BOL,                             ///< Start of line
+    RX_EOL                              ///< End of line
+};
+
+///  @struct rx_node
+///  @brief  Node in parse tree.
+
+struct rx_node
+{
+    enum rx_type type;                  ///< Type of node
+    int left;                           ///< Left (or only) operand
+    int right;                          ///< Right operand
+    int min;                            ///< Min. repeat count
+    int max;                            ///< Max. repeat count (or RX_INF)
+    int group;                          ///< Group number
+    int set;                            ///< Character set index
+    bool greedy;                        ///< true if repeat is greedy
+};
+
+///  @enum   rx_op
+///  @brief  NFA instruction codes. Assertions are made relative to the
+///          direction in which a program reads the text, so that the same
+///          code can be used for both forward and backward programs.
+
+enum rx_op
+{
+    RX_CHAR,                            ///< Match character in set x
+    RX_SPLIT,                           ///< Continue at x, or (if not) at y
+    RX_JMP,                             ///< Continue at x
+    RX_SAVE,                            ///< Save position in slot x
+    RX_BEHIND,                          ///< Preceded by line end or edge
+    RX_AHEAD,                           ///< Followed by line end or edge
+    RX_MATCH                            ///< Match found
+};
+
+///  @struct rx_inst
+///  @brief  NFA instruction.
+
+struct rx_inst
+{
+    enum rx_op op;                      ///< Instruction code
+    int x;                              ///< First operand
+    int y;                              ///< Second operand
+};
+
+///  @struct rx_prog
+///  @brief  NFA program.
+
+struct rx_prog
+{
+    struct rx_inst *inst;               ///< Instructions
+    uint n;                             ///< No. of instructions
+    uint size;                          ///< No. of instructions allocated
+};
+
+///  @struct rx_state
+///  @brief  DFA state, which is the list of NFA instructions that threads
+///          are waiting at, in order of priority, along with whether the
+///          last character read ended a line, and whether new threads may
+///          still be started.
+
+struct rx_state
+{
+    uint off;                           ///< Offset of list in pool
+    uint len;                           ///< No. of instructions in list
+    bool behind;                        ///< Preceded by line end or edge
+    bool nostart;                       ///< No new threads to be started
+};
+
+///  @struct rx_dfa
+///  @brief  Lazily-built DFA. Each state has a transition for each class of
+///          characters, plus one for the end of the text. A transition is -1
+///          if not built yet, or else the next state, shifted left by one,
+///          plus one if a match ended before the character was read.
+
+struct rx_dfa
+{
+    const struct rx_prog *prog;         ///< NFA program
+    bool cut;                           ///< Drop threads after first match
+    uint flushes;                       ///< No. of times cache was flushed
+    uint nstates;                       ///< No. of states
+    uint poollen;                       ///< No. of instructions in pool
+    struct rx_state *state;             ///< States
+    int *pool;                          ///< Instruction lists for states
+    int *hash;                          ///< Hash table for states
+    int *trans;                         ///< Transitions for states
+};
+
+///  @struct rx_list
+///  @brief  Thread list for the Pike VM.
+
+struct rx_list
+{
+    uint n;                             ///< No. of threads
+    int *pc;                            ///< Instruction for each thread
+    int_t *slots;                       ///< Saved positions for each thread
+};
+
+///   @var    rx
+///   @brief  Compiled form of last search string, used if E1&2048 is set.
+
+static struct
+{
+    bool valid;                         ///< true if compiled from last_search
+    int ctrl_x;                         ///< CTRL/X flag when compiled
+    const char *src;                    ///< Expression being parsed
+    uint_t len;                         ///< Length of expression
+    uint_t pos;                         ///< Parse position
+    int ngroups;                        ///< No. of groups
+    int maxlen;                         ///< Max. length of match (or RX_INF)
+    uint nnodes;                        ///< No. of parse tree nodes
+    uint maxnodes;                      ///< No. of parse tree nodes allocated
+    struct rx_node *node;               ///< Parse tree nodes
+    uint nsets;                         ///< No. of character sets
+    uint maxsets;                       ///< No. of character sets allocated
+    uchar (*set)[RX_SETSIZE];           ///< Character sets
+    uint nclasses;                      ///< No. of character classes
+    uint class[UCHAR_MAX + 1];          ///< Class of each character
+    uchar fold[UCHAR_MAX + 1];          ///< Folded value of each character
+    struct rx_prog fwd;                 ///< Forward program
+    struct rx_prog rev;                 ///< Backward program
+    struct rx_dfa dfwd;                 ///< DFA for forward program
+    struct rx_dfa drev;                 ///< DFA for backward program
+    uint gen;                           ///< Current generation for marks
+    uint *mark;                         ///< Generation when each pc visited
+    int *stack;                         ///< Stack for closure()
+    int *list1;                         ///< Work list of instructions
+    int *list2;                         ///< Work list of instructions
+    uint nslots;                        ///< No. of slots for Pike VM
+    struct rx_list pike[2];             ///< Thread lists for Pike VM
+    int_t *caps;                        ///< Saved positions for match
+} rx =
+{
+    .valid = false,
+    .node  = NULL,
+    .set   = NULL,
+    .fwd   = { .inst = NULL },
+    .rev   = { .inst = NULL },
+    .dfwd  = { .state = NULL, .pool = NULL, .hash = NULL, .trans = NULL },
+    .drev  = { .state = NULL, .pool = NULL, .hash = NULL, .trans = NULL },
+    .mark  = NULL,
+    .stack = NULL,
+    .list1 = NULL,
+    .list2 = NULL,
+    .pike  = { { .pc = NULL, .slots = NULL }, { .pc = NULL, .slots = NULL } },
+    .caps  = NULL,
+};
+
+// Local functions
+
+static int add_node(enum rx_type type, int left, int right);
+
+static int add_set(uchar *bits);
+
+static void add_thread(struct rx_list *list, int pc, int_t *slots, int_t pos,
+                       bool behind, bool ahead);
+
+static void build_classes(void);
+
+static uint closure(const struct rx_prog *prog, int *list, uint n, int pc,
+                    bool behind, int ahead);
+
+static void compile_regex(void);
+
+static int dfa_freeze(struct rx_dfa *dfa, int st);
+
+static void dfa_init(struct rx_dfa *dfa, const struct rx_prog *prog, bool cut);
+
+static int dfa_intern(struct rx_dfa *dfa, const int *list, uint n,
+                      bool behind, bool nostart);
+
+static int dfa_start(struct rx_dfa *dfa, bool behind, bool nostart);
+
+static int dfa_step(struct rx_dfa *dfa, int st, int c);
+
+static int emit(struct rx_prog *prog, enum rx_op op, int x, int y);
+
+static void emit_node(struct rx_prog *prog, int n, bool reverse);
+
+static void fold_set(uchar *bits);
+
+static int get_chr(int_t pos);
+
+static int max_len(int n);
+
+static void next_gen(void);
+
+static int parse_alt(void);
+
+static int parse_atom(void);
+
+static int parse_cat(void);
+
+static int parse_class(void);
+
+static bool parse_count(int *min, int *max);
+
+static int parse_escape(uchar *bits);
+
+static int parse_repeat(void);
+
+static void run_pike(int_t pos);
+
+static int_t scan_backward(int_t pos, int_t low, int_t high, bool anchored);
+
+static int_t scan_forward(int_t pos, int_t last);
+
+static void store_groups(int_t start, int_t end);
+
+
+/// @def    inset(bits, c)
+/// @brief  Check whether character is in set.
+
+#define inset(bits, c)  ((bits)[(uchar)(c) / CHAR_BIT] & (1u << ((c) % CHAR_BIT)))
+
+/// @def    addset(bits, c)
+/// @brief  Add character to set.
+
+#define addset(bits, c) ((bits)[(uchar)(c) / CHAR_BIT] |= (uchar)(1u << ((c) % CHAR_BIT)))
+
+
+///
+///  @brief    Add node to parse tree.
+///
+///  @returns  Index of node.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int add_node(enum rx_type type, int left, int right)
+{
+    if (rx.node == NULL)
+    {
+        rx.maxnodes = 16;
+        rx.node     = alloc_mem(rx.maxnodes * sizeof(*rx.node));
+    }
+    else if (rx.nnodes == rx.maxnodes)
+    {
+        rx.node = expand_mem(rx.node, rx.maxnodes * sizeof(*rx.node),
+                             rx.maxnodes * sizeof(*rx.node));
+        rx.maxnodes *= 2;
+    }
+
+    struct rx_node *node = &rx.node[rx.nnodes];
+
+    node->type   = type;
+    node->left   = left;
+    node->right  = right;
+    node->min    = node->max = 1;
+    node->group  = 0;
+    node->set    = -1;
+    node->greedy = true;
+
+    return (int)rx.nnodes++;
+}
+
+
+///
+///  @brief    Add character set, unless we already have the same one.
+///
+///  @returns  Index of set.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int add_set(uchar *bits)
+{
+    assert(bits != NULL);
+
+    for (uint i = 0; i < rx.nsets; ++i)
+    {
+        if (memcmp(rx.set[i], bits, (size_t)RX_SETSIZE) == 0)
+        {
+            return (int)i;
+        }
+    }
+
+    if (rx.set == NULL)
+    {
+        rx.maxsets = 16;
+        rx.set     = alloc_mem(rx.maxsets * sizeof(*rx.set));
+    }
+    else if (rx.nsets == rx.maxsets)
+    {
+        rx.set = expand_mem(rx.set, rx.maxsets * sizeof(*rx.set),
+                            rx.maxsets * sizeof(*rx.set));
+        rx.maxsets *= 2;
+    }
+
+    memcpy(rx.set[rx.nsets], bits, (size_t)RX_SETSIZE);
+
+    return (int)rx.nsets++;
+}
+
+
+///
+///  @brief    Add thread for Pike VM, following any jumps, splits, saves, and
+///            assertions, so that only threads waiting for a character or a
+///            match are added to the list. Threads are added in order of
+///            priority, and only the first thread to reach an instruction is
+///            kept.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void add_thread(struct rx_list *list, int pc, int_t *slots, int_t pos,
+                       bool behind, bool ahead)
+{
+    assert(list != NULL);
+    assert(slots != NULL);
+
+    if (rx.mark[pc] == rx.gen)
+    {
+        return;
+    }
+
+    rx.mark[pc] = rx.gen;
+
+    const struct rx_inst *inst = &rx.fwd.inst[pc];
+
+    switch (inst->op)
+    {
+        case RX_JMP:
+            add_thread(list, inst->x, slots, pos, behind, ahead);
+
+            break;
+
+        case RX_SPLIT:
+            add_thread(list, inst->x, slots, pos, behind, ahead);
+            add_thread(list, inst->y, slots, pos, behind, ahead);
+
+            break;
+
+        case RX_SAVE:
+        {
+            int_t saved = slots[inst->x];
+
+            slots[inst->x] = pos;
+
+            add_thread(list, pc + 1, slots, pos, behind, ahead);
+
+            slots[inst->x] = saved;
+
+            break;
+        }
+
+        case RX_BEHIND:
+            if (behind)
+            {
+                add_thread(list, pc + 1, slots, pos, behind, ahead);
+            }
+
+            break;
+
+        case RX_AHEAD:
+            if (ahead)
+            {
+                add_thread(list, pc + 1, slots, pos, behind, ahead);
+            }
+
+            break;
+
+        default:
+            list->pc[list->n] = pc;
+
+            memcpy(list->slots + list->n * rx.nslots, slots,
+                   rx.nslots * sizeof(*slots));
+
+            ++list->n;
+
+            break;
+    }
+}
+
+
+///
+///  @brief    Divide characters into classes, such that all characters in a
+///            class are in the same character sets, and are either all line
+///            delimiters or all not. The DFAs then need only one transition
+///            for each class.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void build_classes(void)
+{
+    rx.nclasses = 1;
+
+    for (int c = 0; c <= UCHAR_MAX; ++c)
+    {
+        rx.class[c] = isdelim(c) ? 1 : 0;
+
+        if (rx.class[c] != 0)
+        {
+            rx.nclasses = 2;
+        }
+    }
+
+    for (uint i = 0; i < rx.nsets; ++i)
+    {
+        int remap[(UCHAR_MAX + 1) * 2];
+        uint n = 0;
+
+        for (uint j = 0; j < rx.nclasses * 2; ++j)
+        {
+            remap[j] = -1;
+        }
+
+        for (int c = 0; c <= UCHAR_MAX; ++c)
+        {
+            uint key = rx.class[c] * 2 + (inset(rx.set[i], c) ? 1 : 0);
+
+            if (remap[key] == -1)
+            {
+                remap[key] = (int)n++;
+            }
+
+            rx.class[c] = (uint)remap[key];
+        }
+
+        rx.nclasses = n;
+    }
+}
+
+
+///
+///  @brief    Add the instructions that a thread at pc is waiting at to a list.
+///            Jumps, splits, and saves are followed, as are assertions about
+///            the last character read. Assertions about the next character are
+///            followed if we know what it is (ahead is 0 or 1), and are kept
+///            in the list if we don't (ahead is -1).
+///
+///  @returns  New length of list.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static uint closure(const struct rx_prog *prog, int *list, uint n, int pc,
+                    bool behind, int ahead)
+{
+    assert(prog != NULL);
+    assert(list != NULL);
+
+    uint depth = 0;
+
+    rx.stack[depth++] = pc;
+
+    while (depth != 0)
+    {
+        pc = rx.stack[--depth];
+
+        if (rx.mark[pc] == rx.gen)
+        {
+            continue;
+        }
+
+        rx.mark[pc] = rx.gen;
+
+        const struct rx_inst *inst = &prog->inst[pc];
+
+        switch (inst->op)
+        {
+            case RX_JMP:
+                rx.stack[depth++] = inst->x;
+
+                break;
+
+            case RX_SPLIT:              // Push y first, so x is done first
+                rx.stack[depth++] = inst->y;
+                rx.stack[depth++] = inst->x;
+
+                break;
+
+            case RX_SAVE:
+                rx.stack[depth++] = pc + 1;
+
+                break;
+
+            case RX_BEHIND:
+                if (behind)
+                {
+                    rx.stack[depth++] = pc + 1;
+                }
+
+                break;
+
+            case RX_AHEAD:
+                if (ahead == -1)
+                {
+                    list[n++] = pc;
+                }
+                else if (ahead)
+                {
+                    rx.stack[depth++] = pc + 1;
+                }
+
+                break;
+
+            default:
+                list[n++] = pc;
+
+                break;
+        }
+    }
+
+    return n;
+}
+
+
+///
+///  @brief    Compile last search string as a regular expression, if it hasn't
+///            already been compiled for the current setting of the CTRL/X flag.
+///            Characters are folded as they are for other searches.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void compile_regex(void)
+{
+    if (rx.valid && rx.ctrl_x == f.ctrl_x)
+    {
+        return;
+    }
+
+    reset_regex();
+
+    rx.ctrl_x = f.ctrl_x;
+
+    for (int c = 0; c <= UCHAR_MAX; ++c)
+    {
+        int fold = c;
+
+        if (f.ctrl_x != -1 && c != NUL)
+        {
+            fold = toupper(c);
+
+            if (f.ctrl_x == 0 && !isalpha(fold)
+                && strchr("`{|}~", fold) != NULL)
+            {
+                fold -= 'a' - 'A';
+            }
+        }
+
+        rx.fold[c] = (uchar)fold;
+    }
+
+    rx.src     = last_search.data;
+    rx.len     = last_search.len;
+    rx.pos     = 0;
+    rx.ngroups = 0;
+
+    int root = parse_alt();
+
+    if (rx.pos != rx.len)
+    {
+        throw(E_ISS);                   // Unmatched right parenthesis
+    }
+
+    rx.maxlen = max_len(root);
+
+    build_classes();
+
+    emit_node(&rx.fwd, root, (bool)false);
+    (void)emit(&rx.fwd, RX_MATCH, 0, 0);
+
+    emit_node(&rx.rev, root, (bool)true);
+    (void)emit(&rx.rev, RX_MATCH, 0, 0);
+
+    uint size = (rx.fwd.n > rx.rev.n) ? rx.fwd.n : rx.rev.n;
+
+    rx.mark  = alloc_mem(size * sizeof(*rx.mark));
+    rx.stack = alloc_mem((size * 2 + 1) * sizeof(*rx.stack));
+    rx.list1 = alloc_mem(size * sizeof(*rx.list1));
+    rx.list2 = alloc_mem(size * sizeof(*rx.list2));
+    rx.gen   = 0;
+
+    dfa_init(&rx.dfwd, &rx.fwd, (bool)true);
+    dfa_init(&rx.drev, &rx.rev, (bool)false);
+
+    int ngroups = (rx.ngroups < RX_MAXGROUP) ? rx.ngroups : RX_MAXGROUP;
+
+    rx.nslots = (uint)(ngroups + 1) * 2;
+    rx.caps   = alloc_mem(rx.nslots * sizeof(*rx.caps));
+
+    for (uint i = 0; i < countof(rx.pike); ++i)
+    {
+        rx.pike[i].pc    = alloc_mem(rx.fwd.n * sizeof(*rx.pike[i].pc));
+        rx.pike[i].slots = alloc_mem(rx.fwd.n * rx.nslots
+                                     * sizeof(*rx.pike[i].slots));
+    }
+
+    rx.valid = true;
+}
+
+
+///
+///  @brief    Get state with same threads as another state, but which doesn't
+///            start any new ones. Used when we reach the last position at which
+///            a match may start.
+///
+///  @returns  State index.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int dfa_freeze(struct rx_dfa *dfa, int st)
+{
+    assert(dfa != NULL);
+
+    const struct rx_state *state = &dfa->state[st];
+
+    memcpy(rx.list1, dfa->pool + state->off, state->len * sizeof(*rx.list1));
+
+    return dfa_intern(dfa, rx.list1, state->len, state->behind, (bool)true);
+}
+
+
+///
+///  @brief    Initialize DFA for program.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void dfa_init(struct rx_dfa *dfa, const struct rx_prog *prog, bool cut)
+{
+    assert(dfa != NULL);
+    assert(prog != NULL);
+
+    dfa->prog    = prog;
+    dfa->cut     = cut;
+    dfa->flushes = 0;
+    dfa->nstates = 0;
+    dfa->poollen = 0;
+    dfa->state   = alloc_mem(RX_STATES * sizeof(*dfa->state));
+    dfa->pool    = alloc_mem(RX_POOL * sizeof(*dfa->pool));
+    dfa->hash    = alloc_mem(RX_HASH * sizeof(*dfa->hash));
+    dfa->trans   = alloc_mem(RX_STATES * (rx.nclasses + 1)
+                             * sizeof(*dfa->trans));
+
+    memset(dfa->hash, 0xff, RX_HASH * sizeof(*dfa->hash));
+}
+
+
+///
+///  @brief    Find or add DFA state. If the cache is full, all states are
+///            discarded first, so callers must not use any state indices they
+///            got before calling this function.
+///
+///  @returns  State index.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int dfa_intern(struct rx_dfa *dfa, const int *list, uint n,
+                      bool behind, bool nostart)
+{
+    assert(dfa != NULL);
+    assert(list != NULL);
+
+    uint hash = 2166136261u;            // FNV-1a hash of state
+
+    for (uint i = 0; i < n; ++i)
+    {
+        hash = (hash ^ (uint)list[i]) * 16777619u;
+    }
+
+    hash = (hash ^ (behind ? 1u : 0u) ^ (nostart ? 2u : 0u)) * 16777619u;
+
+    uint h = hash % RX_HASH;
+    int st;
+
+    while ((st = dfa->hash[h]) != -1)
+    {
+        const struct rx_state *state = &dfa->state[st];
+
+        if (state->len == n && state->behind == behind
+            && state->nostart == nostart
+            && memcmp(dfa->pool + state->off, list, n * sizeof(*list)) == 0)
+        {
+            return st;
+        }
+
+        h = (h + 1) % RX_HASH;
+    }
+
+    if (dfa->nstates == RX_STATES || dfa->poollen + n > RX_POOL)
+    {
+        ++dfa->flushes;
+
+        dfa->nstates = 0;
+        dfa->poollen = 0;
+
+        memset(dfa->hash, 0xff, RX_HASH * sizeof(*dfa->hash));
+
+        h = hash % RX_HASH;
+    }
+
+    st = (int)dfa->nstates++;
+
+    struct rx_state *state = &dfa->state[st];
+
+    state->off     = dfa->poollen;
+    state->len     = n;
+    state->behind  = behind;
+    state->nostart = nostart;
+
+    memcpy(dfa->pool + state->off, list, n * sizeof(*list));
+
+    dfa->poollen += n;
+    dfa->hash[h] = st;
+
+    memset(dfa->trans + (uint)st * (rx.nclasses + 1), 0xff,
+           (rx.nclasses + 1) * sizeof(*dfa->trans));
+
+    return st;
+}
+
+
+///
+///  @brief    Get starting state for DFA.
+///
+///  @returns  State index.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int dfa_start(struct rx_dfa *dfa, bool behind, bool nostart)
+{
+    assert(dfa != NULL);
+
+    next_gen();
+
+    uint n = closure(dfa->prog, rx.list1, 0, 0, behind, -1);
+
+    return dfa_intern(dfa, rx.list1, n, behind, nostart);
+}
+
+
+///
+///  @brief    Get transition from DFA state for character (or for the end of
+///            the text), building the next state if necessary.
+///
+///            Any assertions about the next character are resolved first, and
+///            we then note whether any thread has matched. If so, and we only
+///            want the first match, all threads after it are dropped, since
+///            their matches would have lower priority, and no more threads
+///            are started. The remaining threads then read the character, and
+///            unless we're done starting threads, a new one is started.
+///
+///  @returns  Transition (next state shifted left by one, plus one if a match
+///            ended before the character).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int dfa_step(struct rx_dfa *dfa, int st, int c)
+{
+    assert(dfa != NULL);
+
+    uint cls = (c == RX_EOT) ? rx.nclasses : rx.class[c];
+    int tr = dfa->trans[(uint)st * (rx.nclasses + 1) + cls];
+
+    if (tr != -1)
+    {
+        return tr;
+    }
+
+    const struct rx_prog *prog = dfa->prog;
+    const struct rx_state *state = &dfa->state[st];
+    bool edge = (c == RX_EOT || isdelim(c));
+    bool matched = false;
+    uint n = 0;
+
+    next_gen();
+
+    for (uint i = 0; i < state->len; ++i)
+    {
+        n = closure(prog, rx.list1, n, dfa->pool[state->off + i],
+                    state->behind, edge ? 1 : 0);
+    }
+
+    for (uint i = 0; i < n; ++i)
+    {
+        if (prog->inst[rx.list1[i]].op == RX_MATCH)
+        {
+            matched = true;
+
+            if (dfa->cut)
+            {
+                n = i + 1;
+            }
+
+            break;
+        }
+    }
+
+    tr = matched ? 1 : 0;
+
+    if (c != RX_EOT)
+    {
+        bool nostart = state->nostart || (matched && dfa->cut);
+        uint flushes = dfa->flushes;
+        uint m = 0;
+
+        next_gen();
+
+        for (uint i = 0; i < n; ++i)
+        {
+            const struct rx_inst *inst = &prog->inst[rx.list1[i]];
+
+            if (inst->op == RX_CHAR && inset(rx.set[inst->x], c))
+            {
+                m = closure(prog, rx.list2, m, rx.list1[i] + 1, edge, -1);
+            }
+        }
+
+        if (!nostart)
+        {
+            m = closure(prog, rx.list2, m, 0, edge, -1);
+        }
+
+        tr |= dfa_intern(dfa, rx.list2, m, edge, nostart) << 1;
+
+        if (flushes != dfa->flushes)
+        {
+            return tr;                  // Old state is gone
+        }
+    }
+
+    dfa->trans[(uint)st * (rx.nclasses + 1) + cls] = tr;
+
+    return tr;
+}
+
+
+///
+///  @brief    Add instruction to program.
+///
+///  @returns  Index of instruction.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int emit(struct rx_prog *prog, enum rx_op op, int x, int y)
+{
+    assert(prog != NULL);
+
+    if (prog->inst == NULL)
+    {
+        prog->size = 64;
+        prog->inst = alloc_mem(prog->size * sizeof(*prog->inst));
+    }
+    else if (prog->n == prog->size)
+    {
+        if (prog->size == RX_MAXPROG)
+        {
+            throw(E_MAX);               // Internal program limit reached
+        }
+
+        uint delta = prog->size;
+
+        if (prog->size + delta > RX_MAXPROG)
+        {
+            delta = RX_MAXPROG - prog->size;
+        }
+
+        prog->inst = expand_mem(prog->inst, prog->size * sizeof(*prog->inst),
+                                delta * sizeof(*prog->inst));
+        prog->size += delta;
+    }
+
+    struct rx_inst *inst = &prog->inst[prog->n];
+
+    inst->op = op;
+    inst->x  = x;
+    inst->y  = y;
+
+    return (int)prog->n++;
+}
+
+
+///
+///  @brief    Generate instructions for parse tree node. The backward program
+///            matches the same strings, read from right to left; it has no
+///            saves, and ignores priorities.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void emit_node(struct rx_prog *prog, int n, bool reverse)
+{
+    assert(prog != NULL);
+
+    const struct rx_node *node = &rx.node[n];
+    int pc, jmp;
+
+    switch (node->type)
+    {
+        case RX_SET:
+            (void)emit(prog, RX_CHAR, node->set, 0);
+
+            break;
+
+        case RX_CAT:
+            emit_node(prog, reverse ? node->right : node->left, reverse);
+            emit_node(prog, reverse ? node->left : node->right, reverse);
+
+            break;
+
+        case RX_ALT:
+            pc = emit(prog, RX_SPLIT, 0, 0);
+            prog->inst[pc].x = pc + 1;
+            emit_node(prog, node->left, reverse);
+            jmp = emit(prog, RX_JMP, 0, 0);
+            prog->inst[pc].y = (int)prog->n;
+            emit_node(prog, node->right, reverse);
+            prog->inst[jmp].x = (int)prog->n;
+
+            break;
+
+        case RX_GROUP:
+            if (reverse || node->group > RX_MAXGROUP)
+            {
+                emit_node(prog, node->left, reverse);
+            }
+            else
+            {
+                (void)emit(prog, RX_SAVE, node->group * 2, 0);
+                emit_node(prog, node->left, reverse);
+                (void)emit(prog, RX_SAVE, node->group * 2 + 1, 0);
+            }
+
+            break;
+
+        case RX_BOL:
+            (void)emit(prog, reverse ? RX_AHEAD : RX_BEHIND, 0, 0);
+
+            break;
+
+        case RX_EOL:
+            (void)emit(prog, reverse ? RX_BEHIND : RX_AHEAD, 0, 0);
+
+            break;
+
+        case RX_REPEAT:
+            for (int i = 0; i < node->min; ++i)
+            {
+                emit_node(prog, node->left, reverse);
+            }
+
+            if (node->max == RX_INF)
+            {
+                pc = emit(prog, RX_SPLIT, 0, 0);
+                emit_node(prog, node->left, reverse);
+                (void)emit(prog, RX_JMP, pc, 0);
+            }
+            else
+            {
+                // Each optional copy skips to the end if it isn't taken.
+
+                pc = (int)prog->n;
+
+                for (int i = node->min; i < node->max; ++i)
+                {
+                    (void)emit(prog, RX_SPLIT, 0, 0);
+                    emit_node(prog, node->left, reverse);
+                }
+            }
+
+            // Fix up the splits we just added: those for optional copies have
+            // zero operands, since nothing can jump back to instruction 0.
+
+            for (uint i = (uint)pc; i < prog->n; ++i)
+            {
+                struct rx_inst *inst = &prog->inst[i];
+
+                if (inst->op == RX_SPLIT && inst->x == 0 && inst->y == 0)
+                {
+                    int body = (int)i + 1;
+                    int end  = (int)prog->n;
+
+                    inst->x = node->greedy ? body : end;
+                    inst->y = node->greedy ? end : body;
+                }
+            }
+
+            break;
+
+        default:
+        case RX_EMPTY:
+            break;
+    }
+}
+
+
+///
+///  @brief    Add all characters with the same folded value as any character
+///            already in a set.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void fold_set(uchar *bits)
+{
+    assert(bits != NULL);
+
+    uchar folded[RX_SETSIZE] = { 0 };
+
+    for (int c = 0; c <= UCHAR_MAX; ++c)
+    {
+        if (inset(bits, c))
+        {
+            addset(folded, rx.fold[c]);
+        }
+    }
+
+    for (int c = 0; c <= UCHAR_MAX; ++c)
+    {
+        if (inset(folded, rx.fold[c]))
+        {
+            addset(bits, c);
+        }
+    }
+}
+
+
+///
+///  @brief    Get character at absolute position in edit buffer.
+///
+///  @returns  Character, or RX_EOT if outside of buffer.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int get_chr(int_t pos)
+{
+    int c = read_edit(pos - t->dot);
+
+    return (c == EOF) ? RX_EOT : c;
+}
+
+
+///
+///  @brief    Get maximum length of string matched by parse tree node.
+///
+///  @returns  Length, or RX_INF if unbounded.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int max_len(int n)
+{
+    const struct rx_node *node = &rx.node[n];
+    int left, right;
+
+    switch (node->type)
+    {
+        case RX_SET:
+            return 1;
+
+        case RX_CAT:
+        case RX_ALT:
+            left  = max_len(node->left);
+            right = max_len(node->right);
+
+            if (left == RX_INF || right == RX_INF)
+            {
+                return RX_INF;
+            }
+
+            if (node->type == RX_ALT)
+            {
+                return (left > right) ? left : right;
+            }
+
+            return (left + right > INT_MAX / 2) ? RX_INF : left + right;
+
+        case RX_GROUP:
+            return max_len(node->left);
+
+        case RX_REPEAT:
+            left = max_len(node->left);
+
+            if (left == 0 || node->max == 0)
+            {
+                return 0;
+            }
+            else if (left == RX_INF || node->max == RX_INF
+                     || left > INT_MAX / 2 / node->max)
+            {
+                return RX_INF;
+            }
+
+            return left * node->max;
+
+        default:
+            return 0;
+    }
+}
+
+
+///
+///  @brief    Start new generation of marks for closure() and add_thread().
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void next_gen(void)
+{
+    if (++rx.gen == 0)                  // Clear marks if we wrapped around
+    {
+        uint size = (rx.fwd.n > rx.rev.n) ? rx.fwd.n : rx.rev.n;
+
+        memset(rx.mark, 0, size * sizeof(*rx.mark));
+
+        rx.gen = 1;
+    }
+}
+
+
+///
+///  @brief    Parse alternation: cat|cat|...
+///
+///  @returns  Index of node.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int parse_alt(void)
+{
+    int left = parse_cat();
+
+    while (rx.pos < rx.len && rx.src[rx.pos] == '|')
+    {
+        ++rx.pos;
+
+        int right = parse_cat();
+
+        left = add_node(RX_ALT, left, right);
+    }
+
+    return left;
+}
+
+
+///
+///  @brief    Parse atom: a character, a class, a group, or an anchor.
+///
+///  @returns  Index of node.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int parse_atom(void)
+{
+    uchar bits[RX_SETSIZE] = { 0 };
+    int c = (uchar)rx.src[rx.pos++];
+    int node;
+
+    switch (c)
+    {
+        case '(':
+        {
+            int group = 0;
+
+            if (rx.pos + 1 < rx.len && rx.src[rx.pos] == '?'
+                && rx.src[rx.pos + 1] == ':')
+            {
+                rx.pos += 2;            // (?:...) doesn't save its position
+            }
+            else
+            {
+                group = ++rx.ngroups;
+            }
+
+            node = parse_alt();
+
+            if (rx.pos == rx.len || rx.src[rx.pos] != ')')
+            {
+                throw(E_ISS);           // Missing right parenthesis
+            }
+
+            ++rx.pos;
+
+            if (group != 0)
+            {
+                node = add_node(RX_GROUP, node, -1);
+
+                rx.node[node].group = group;
+            }
+
+            return node;
+        }
+
+        case '[':
+            return parse_class();
+
+        case '^':
+            return add_node(RX_BOL, -1, -1);
+
+        case '$':
+            return add_node(RX_EOL, -1, -1);
+
+        case '*':
+        case '+':
+        case '?':
+            throw(E_ISS);               // Nothing to repeat
+
+        case '.':
+            for (c = 0; c <= UCHAR_MAX; ++c)
+            {
+                if (!isdelim(c))
+                {
+                    addset(bits, c);
+                }
+            }
+
+            break;
+
+        case '\\':
+            if ((c = parse_escape(bits)) == -1)
+            {
+                break;
+            }
+            //lint -fallthrough
+
+        default:
+            addset(bits, c);
+            fold_set(bits);
+
+            break;
+    }
+
+    node = add_node(RX_SET, -1, -1);
+
+    rx.node[node].set = add_set(bits);
+
+    return node;
+}
+
+
+///
+///  @brief    Parse concatenation of repeated atoms.
+///
+///  @returns  Index of node.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int parse_cat(void)
+{
+    int left = -1;
+
+    while (rx.pos < rx.len && rx.src[rx.pos] != '|' && rx.src[rx.pos] != ')')
+    {
+        int right = parse_repeat();
+
+        left = (left == -1) ? right : add_node(RX_CAT, left, right);
+    }
+
+    return (left == -1) ? add_node(RX_EMPTY, -1, -1) : left;
+}
+
+
+///
+///  @brief    Parse bracketed character class, such as [a-z_] or [^0-9].
+///
+///  @returns  Index of node.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int parse_class(void)
+{
+    uchar bits[RX_SETSIZE] = { 0 };
+    bool negate = false;
+    bool first = true;
+
+    if (rx.pos < rx.len && rx.src[rx.pos] == '^')
+    {
+        negate = true;
+        ++rx.pos;
+    }
+
+    for (;;)
+    {
+        if (rx.pos == rx.len)
+        {
+            throw(E_ISS);               // Missing right bracket
+        }
+
+        int c = (uchar)rx.src[rx.pos++];
+
+        if (c == ']' && !first)
+        {
+            break;
+        }
+
+        first = false;
+
+        if (c == '\\' && (c = parse_escape(bits)) == -1)
+        {
+            continue;
+        }
+
+        int last = c;
+
+        if (rx.pos + 1 < rx.len && rx.src[rx.pos] == '-'
+            && rx.src[rx.pos + 1] != ']')
+        {
+            ++rx.pos;
+
+            last = (uchar)rx.src[rx.pos++];
+
+            if (last == '\\' && (last = parse_escape(bits)) == -1)
+            {
+                throw(E_ISS);           // Range can't end with class
+            }
+
+            if (last < c)
+            {
+                throw(E_ISS);           // Range is backward
+            }
+        }
+
+        while (c <= last)
+        {
+            addset(bits, c);
+
+            ++c;
+        }
+    }
+
+    fold_set(bits);
+
+    if (negate)
+    {
+        for (uint i = 0; i < RX_SETSIZE; ++i)
+        {
+            bits[i] = (uchar)~bits[i];
+        }
+    }
+
+    int node = add_node(RX_SET, -1, -1);
+
+    rx.node[node].set = add_set(bits);
+
+    return node;
+}
+
+
+///
+///  @brief    Parse count following left brace: {m}, {m,}, or {m,n}. If the
+///            brace isn't followed by a valid count, it's an ordinary
+///            character.
+///
+///  @returns  true if count parsed, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool parse_count(int *min, int *max)
+{
+    assert(min != NULL);
+    assert(max != NULL);
+
+    uint_t pos = rx.pos + 1;
+    int n = 0;
+    int m;
+
+    if (pos == rx.len || !isdigit((uchar)rx.src[pos]))
+    {
+        return false;
+    }
+
+    while (pos < rx.len && isdigit((uchar)rx.src[pos]))
+    {
+        n = n * 10 + (rx.src[pos++] - '0');
+
+        if (n > RX_MAXREPEAT)
+        {
+            throw(E_ISS);               // Count is too large
+        }
+    }
+
+    m = n;
+
+    if (pos < rx.len && rx.src[pos] == ',')
+    {
+        ++pos;
+
+        if (pos < rx.len && isdigit((uchar)rx.src[pos]))
+        {
+            n = 0;
+
+            while (pos < rx.len && isdigit((uchar)rx.src[pos]))
+            {
+                n = n * 10 + (rx.src[pos++] - '0');
+
+                if (n > RX_MAXREPEAT)
+                {
+                    throw(E_ISS);       // Count is too large
+                }
+            }
+
+            if (n < m)
+            {
+                throw(E_ISS);           // Counts are backward
+            }
+        }
+        else
+        {
+            n = RX_INF;
+        }
+    }
+
+    if (pos == rx.len || rx.src[pos] != '}')
+    {
+        return false;
+    }
+
+    rx.pos = pos + 1;
+    *min   = m;
+    *max   = n;
+
+    return true;
+}
+
+
+///
+///  @brief    Parse character following backslash. Class escapes are added to
+///            the set; anything else stands for a single character.
+///
+///  @returns  Character, or -1 if class added to set.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int parse_escape(uchar *bits)
+{
+    assert(bits != NULL);
+
+    if (rx.pos == rx.len)
+    {
+        throw(E_ISS);                   // Trailing backslash
+    }
+
+    int c = (uchar)rx.src[rx.pos++];
+    uchar class[RX_SETSIZE] = { 0 };
+
+    switch (c)
+    {
+        case 'n':
+            return LF;
+
+        case 't':
+            return TAB;
+
+        case 'd':
+        case 'D':
+            for (int i = '0'; i <= '9'; ++i)
+            {
+                addset(class, i);
+            }
+
+            break;
+
+        case 'w':
+        case 'W':
+            for (int i = 0; i <= UCHAR_MAX; ++i)
+            {
+                if (i <= SCHAR_MAX && (isalnum(i) || i == '_'))
+                {
+                    addset(class, i);
+                }
+            }
+
+            break;
+
+        case 's':
+        case 'S':
+            for (const char *p = " \t\n\v\f\r"; *p != NUL; ++p)
+            {
+                addset(class, *p);
+            }
+
+            break;
+
+        default:
+            if (isdigit(c))
+            {
+                throw(E_ISS);           // Back references aren't supported
+            }
+
+            return c;
+    }
+
+    for (uint i = 0; i < RX_SETSIZE; ++i)
+    {
+        bits[i] |= isupper(c) ? (uchar)~class[i] : class[i];
+    }
+
+    return -1;
+}
+
+
+///
+///  @brief    Parse atom followed by any repeat operators: *, +, ?, or a count
+///            in braces. Any of these may be followed by ? to make it lazy.
+///
+///  @returns  Index of node.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int parse_repeat(void)
+{
+    int node = parse_atom();
+
+    while (rx.pos < rx.len)
+    {
+        int c = rx.src[rx.pos];
+        int min, max;
+
+        if (c == '*')
+        {
+            min = 0, max = RX_INF;
+        }
+        else if (c == '+')
+        {
+            min = 1, max = RX_INF;
+        }
+        else if (c == '?')
+        {
+            min = 0, max = 1;
+        }
+        else if (c != '{' || !parse_count(&min, &max))
+        {
+            break;
+        }
+
+        if (c != '{')
+        {
+            ++rx.pos;
+        }
+
+        node = add_node(RX_REPEAT, node, -1);
+
+        rx.node[node].min = min;
+        rx.node[node].max = max;
+
+        if (rx.pos < rx.len && rx.src[rx.pos] == '?')
+        {
+            ++rx.pos;
+
+            rx.node[node].greedy = false;
+        }
+    }
+
+    return node;
+}
+
+
+///
+///  @brief    Search backward for regular expression. This checks the same
+///            positions as search_backward(), and leaves the search block in
+///            the same state.
+///
+///  @returns  true if found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool regex_backward(struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    compile_regex();
+
+    int_t dot  = t->dot;
+    int_t high = s->text_start + dot;   // First (highest) position to check
+    int_t low  = s->text_end + dot;     // Last (lowest) position to check
+
+    if (high > t->Z)
+    {
+        high = t->Z;
+    }
+
+    if (low < t->B)
+    {
+        low = t->B;
+    }
+
+    if (high >= low)
+    {
+        // A match that starts by the highest position can't end later than
+        // its maximum length after it.
+
+        int_t top = t->Z;
+
+        if (rx.maxlen != RX_INF && high + rx.maxlen < top)
+        {
+            top = high + rx.maxlen;
+        }
+
+        int_t start = scan_backward(top, low, high, (bool)false);
+
+        if (start != -1)
+        {
+            int_t end = scan_forward(start, start);
+
+            assert(end != -1);
+
+            store_groups(start, end);
+
+            s->match_start = start - dot;
+            s->text_start  = start - 1 - dot;
+            s->text_pos    = end - dot;
+
+            return true;
+        }
+    }
+
+    if (s->text_start >= s->text_end)
+    {
+        s->text_start = s->text_end - 1;
+    }
+
+    return false;
+}
+
+
+///
+///  @brief    Search forward for regular expression. This checks the same
+///            positions as search_forward(), and leaves the search block in
+///            the same state, except that if the match is empty, the next
+///            search starts at the following character.
+///
+///  @returns  true if found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool regex_forward(struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    compile_regex();
+
+    int_t dot   = t->dot;
+    int_t first = s->text_start + dot;  // First (lowest) position to check
+    int_t last  = s->text_end - 1 + dot; // Last (highest) position to check
+
+    if (s->type == SEARCH_C)            // ::S only checks first position
+    {
+        last = first;
+    }
+
+    if (first < t->B)
+    {
+        first = t->B;
+    }
+
+    if (first <= last && first <= t->Z)
+    {
+        int_t end = scan_forward(first, last);
+
+        if (end != -1)
+        {
+            int_t start = scan_backward(end, first, end, (bool)true);
+
+            assert(start != -1);
+
+            store_groups(start, end);
+
+            s->match_start = start - dot;
+            s->text_pos    = end - dot;
+
+            // See search_forward() for how movedot affects this.
+
+            if (f.ed.movedot || start == end)
+            {
+                s->text_start = start + 1 - dot;
+            }
+            else
+            {
+                s->text_start = end - dot;
+            }
+
+            return true;
+        }
+    }
+
+    if (s->text_start < s->text_end)
+    {
+        if (s->type == SEARCH_C)
+        {
+            ++s->text_start;
+        }
+        else
+        {
+            s->text_start = s->text_end;
+        }
+    }
+
+    return false;
+}
+
+
+///
+///  @brief    Get the maximum length of a match for the regular expression,
+///            compiling it if necessary.
+///
+///  @returns  No. of characters, or -1 if there is no limit.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int_t regex_length(void)
+{
+    compile_regex();
+
+    return (rx.maxlen == RX_INF) ? -1 : (int_t)rx.maxlen;
+}
+
+
+///
+///  @brief    Deallocate memory for compiled regular expression.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void reset_regex(void)
+{
+    struct rx_dfa *dfas[] = { &rx.dfwd, &rx.drev };
+
+    for (uint i = 0; i < countof(dfas); ++i)
+    {
+        free_mem(&dfas[i]->state);
+        free_mem(&dfas[i]->pool);
+        free_mem(&dfas[i]->hash);
+        free_mem(&dfas[i]->trans);
+    }
+
+    for (uint i = 0; i < countof(rx.pike); ++i)
+    {
+        free_mem(&rx.pike[i].pc);
+        free_mem(&rx.pike[i].slots);
+    }
+
+    free_mem(&rx.node);
+    free_mem(&rx.set);
+    free_mem(&rx.fwd.inst);
+    free_mem(&rx.rev.inst);
+    free_mem(&rx.mark);
+    free_mem(&rx.stack);
+    free_mem(&rx.list1);
+    free_mem(&rx.list2);
+    free_mem(&rx.caps);
+
+    rx.valid    = false;
+    rx.nnodes   = rx.maxnodes = 0;
+    rx.nsets    = rx.maxsets = 0;
+    rx.fwd.n    = rx.fwd.size = 0;
+    rx.rev.n    = rx.rev.size = 0;
+}
+
+
+///
+///  @brief    Run Pike VM over match starting at position, to find the
+///            positions of its groups. Threads are kept in order of priority,
+///            so the match found is the same one that the forward DFA found.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void run_pike(int_t pos)
+{
+    struct rx_list *cur  = &rx.pike[0];
+    struct rx_list *next = &rx.pike[1];
+    int_t slots[(RX_MAXGROUP + 1) * 2];
+
+    for (uint i = 0; i < rx.nslots; ++i)
+    {
+        slots[i] = rx.caps[i] = -1;
+    }
+
+    int c = get_chr(pos);
+    bool behind = (pos == t->B || isdelim(get_chr(pos - 1)));
+
+    next_gen();
+
+    cur->n = 0;
+
+    add_thread(cur, 0, slots, pos, behind, c == RX_EOT || isdelim(c));
+
+    while (cur->n != 0)
+    {
+        int ahead = (c == RX_EOT) ? RX_EOT : get_chr(pos + 1);
+
+        next_gen();
+
+        next->n = 0;
+
+        for (uint i = 0; i < cur->n; ++i)
+        {
+            const struct rx_inst *inst = &rx.fwd.inst[cur->pc[i]];
+            int_t *p = cur->slots + i * rx.nslots;
+
+            if (inst->op == RX_MATCH)
+            {
+                memcpy(rx.caps, p, rx.nslots * sizeof(*p));
+
+                rx.caps[1] = pos;
+
+                break;                  // Drop lower-priority threads
+            }
+            else if (c != RX_EOT && inset(rx.set[inst->x], c))
+            {
+                add_thread(next, cur->pc[i] + 1, p, pos + 1, isdelim(c),
+                           ahead == RX_EOT || isdelim(ahead));
+            }
+        }
+
+        if (c == RX_EOT)
+        {
+            break;
+        }
+
+        struct rx_list *tmp = cur;
+
+        cur  = next;
+        next = tmp;
+        c    = ahead;
+
+        ++pos;
+    }
+}
+
+
+///
+///  @brief    Scan backward with the backward DFA. If anchored, the DFA starts
+///            only at the initial position, and we find the lowest position
+///            where it matches; that's where the match that ends there starts.
+///            Otherwise, the DFA starts at every position, and we find the
+///            highest position (not above high) where some match starts.
+///
+///  @returns  Position found, or -1 if none.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t scan_backward(int_t pos, int_t low, int_t high, bool anchored)
+{
+    struct rx_dfa *dfa = &rx.drev;
+    int c = get_chr(pos);
+    int st = dfa_start(dfa, c == RX_EOT || isdelim(c), anchored);
+    int_t found = -1;
+
+    while (pos > t->B)
+    {
+        int_t start, end;
+        const uchar *base = (const uchar *)block_edit(pos - 1, &start, &end);
+
+        while (pos > start)
+        {
+            int tr = dfa_step(dfa, st, base[pos - 1]);
+
+            if ((tr & 1) && pos <= high)
+            {
+                found = pos;
+
+                if (!anchored)
+                {
+                    return found;
+                }
+            }
+
+            if (pos == low)
+            {
+                return found;
+            }
+
+            const struct rx_state *state = &dfa->state[st = tr >> 1];
+
+            --pos;
+
+            if (state->len == 0 && state->nostart)
+            {
+                return found;
+            }
+        }
+    }
+
+    if ((dfa_step(dfa, st, RX_EOT) & 1) && pos <= high)
+    {
+        found = pos;
+    }
+
+    return found;
+}
+
+
+///
+///  @brief    Scan forward with the forward DFA, starting threads at each
+///            position through last, and continuing until no threads are
+///            left. Since threads after the first match are dropped, the last
+///            match seen is where the leftmost match ends.
+///
+///  @returns  End of match, or -1 if none.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t scan_forward(int_t pos, int_t last)
+{
+    struct rx_dfa *dfa = &rx.dfwd;
+    int st = dfa_start(dfa, pos == t->B || isdelim(get_chr(pos - 1)),
+                       pos >= last);
+    int_t found = -1;
+
+    while (pos < t->Z)
+    {
+        int_t start, end;
+        const uchar *base = (const uchar *)block_edit(pos, &start, &end);
+
+        while (pos < end)
+        {
+            int tr = dfa_step(dfa, st, base[pos]);
+
+            if (tr & 1)
+            {
+                found = pos;
+            }
+
+            const struct rx_state *state = &dfa->state[st = tr >> 1];
+
+            ++pos;
+
+            if (state->nostart)
+            {
+                if (state->len == 0)
+                {
+                    return found;
+                }
+            }
+            else if (pos >= last)
+            {
+                st = dfa_freeze(dfa, st);
+            }
+        }
+    }
+
+    if (dfa_step(dfa, st, RX_EOT) & 1)
+    {
+        found = pos;
+    }
+
+    return found;
+}
+
+
+///
+///  @brief    Store the position and text of each group in the match in the
+///            Q-register with the same digit: group 1 in Q-register 1, and so
+///            on. The numeric value is -1 if the group didn't match.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void store_groups(int_t start, int_t end)
+{
+    if (rx.ngroups == 0)
+    {
+        return;
+    }
+
+    run_pike(start);
+
+    assert(rx.caps[1] == end);
+
+    for (uint i = 1; i < rx.nslots / 2; ++i)
+    {
+        int qindex = get_qindex((int)('0' + i), (bool)false);
+        int_t first = rx.caps[i * 2];
+        int_t last  = rx.caps[i * 2 + 1];
+
+        store_qnum(qindex, first);
+
+        if (first == -1 || last <= first)
+        {
+            delete_qtext(qindex);
+        }
+        else
+        {
+            tbuffer text = alloc_tbuf((uint_t)(last - first));
+
+            for (int_t pos = first; pos < last; ++pos)
+            {
+                text.data[text.len++] = (char)get_chr(pos);
+            }
+
+            store_qtext(qindex, &text);
+        }
+    }
+}
@@ -59,7 +59,9 @@ void exec_S(struct cmd *cmd)
 
 
 ///
-///  @brief    Execute FS command: local search and replace.
+///  @brief    Execute FS command: local search and replace. If double colon-
+///            modified, replace all occurrences following dot, and return the
+///            no. of replacements.
 ///
 ///  @returns  Nothing.
 ///
@@ -86,6 +88,10 @@ static void exec_search(struct cmd *cmd, bool replace)
     {
         throw(E_ISA);                   // Invalid search argument
     }
+    else if (replace && cmd->dcolon && cmd->n_set && cmd->n_arg < 0)
+    {
+        throw(E_ISA);                   // ::FS only searches forward
+    }
 
     struct search s;
 
@@ -127,7 +133,7 @@ static void exec_search(struct cmd *cmd, bool replace)
         throw(E_SRH, "");               // Nothing to search for
     }
 
-    if (cmd->dcolon)
+    if (s.type == SEARCH_C)
     {
         s.search     = search_forward;
         s.count      = 1;
@@ -187,6 +193,13 @@ static void exec_search(struct cmd *cmd, bool replace)
         }
     }
 
+    if (replace && cmd->dcolon)         // ::FS => replace all occurrences
+    {
+        push_x(replace_all(&s, cmd->text2.data, cmd->text2.len), X_OPERAND);
+
+        return;
+    }
+
     if (search_loop(&s))
     {
         if (replace)
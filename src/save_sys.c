@@ -0,0 +1,298 @@
+///
+///  @file    save_sys.c
+///  @brief   System-dependent functions for background saves of output files.
+///
+///  @copyright 2019-2022 Franklin P. Johnston / Nowwith Treble Software
+///
+///  Permission is hereby granted, free of charge, to any person obtaining a
+///  copy of this software and associated documentation files (the "Software"),
+///  to deal in the Software without restriction, including without limitation
+///  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///  and/or sell copies of the Software, and to permit persons to whom the
+///  Software is furnished to do so, subject to the following conditions:
+///
+///  The above copyright notice and this permission notice shall be included in
+///  all copies or substantial portions of the Software.
+///
+///  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIA-
+///  BILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///  THE SOFTWARE.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include "teco.h"
+#include "editbuf.h"
+#include "eflags.h"
+#include "errcodes.h"
+#include "exec.h"
+#include "file.h"
+#include "page.h"
+#include "term.h"
+
+
+///  @struct  save
+///  @brief   State of background save.
+
+struct save
+{
+    pid_t pid;                      ///< Process ID of saver (0 if none)
+    int fd;                         ///< Read end of saver's output pipe
+    char *name;                     ///< Name of file being saved
+    bool failed;                    ///< true if last save failed
+};
+
+static struct save save = { .pid = 0, .fd = -1, .name = NULL, .failed = false };
+
+
+// Local functions
+
+static void detach_file(FILE *fp);
+
+static void finish_save(void);
+
+
+///
+///  @brief    Check on the status of any background save. If the save has
+///            completed, then reap the process, and report any errors it
+///            encountered. When peeking (as when the display is refreshed),
+///            we only return the state, since reporting errors would print to
+///            the terminal; the saver is then reaped by the next poll.
+///
+///  @returns  Process ID if save is in progress, -1 if the last save failed,
+///            and 0 otherwise.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int check_save(enum save_check check)
+{
+    if (save.pid != 0 && check == SAVE_PEEK)
+    {
+        return (int)save.pid;
+    }
+    else if (save.pid != 0)
+    {
+        int options = (check == SAVE_WAIT) ? 0 : WNOHANG;
+        int status;
+        pid_t pid;
+
+        while ((pid = waitpid(save.pid, &status, options)) == -1
+               && errno == EINTR)
+        {
+            ;
+        }
+
+        if (pid == 0)
+        {
+            return (int)save.pid;       // Still running
+        }
+
+        save.failed = (pid == -1 || !WIFEXITED(status)
+                       || WEXITSTATUS(status) != EXIT_SUCCESS);
+
+        finish_save();
+    }
+
+    return save.failed ? -1 : 0;
+}
+
+
+///
+///  @brief    Make sure that a file descriptor we share with the saver can't
+///            affect it, by pointing the descriptor at the null device. This
+///            ensures that nothing we do when we close the stream (such as
+///            the seek done by fclose() on an input stream) can move the file
+///            offset out from under the saver.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void detach_file(FILE *fp)
+{
+    if (fp != NULL)
+    {
+        int null = open("/dev/null", O_RDWR);
+
+        if (null != -1)
+        {
+            dup2(null, fileno(fp));
+            close(null);
+        }
+    }
+}
+
+
+///
+///  @brief    Clean up after saver exits. Any output it wrote (i.e., error
+///            messages) is copied to the terminal.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void finish_save(void)
+{
+    char buf[KB];
+    ssize_t nbytes;
+
+    while ((nbytes = read(save.fd, buf, sizeof(buf))) != 0)
+    {
+        if (nbytes > 0)
+        {
+            tprint("%.*s", (int)nbytes, buf);
+        }
+        else if (errno != EINTR)
+        {
+            break;
+        }
+    }
+
+    close(save.fd);
+
+    if (save.failed)
+    {
+        tprint("%%Background save failed for '%s'\n", save.name);
+    }
+
+    free_mem(&save.name);
+
+    save.pid = 0;
+    save.fd  = -1;
+}
+
+
+///
+///  @brief    Start background save for EC command. We fork a copy of TECO,
+///            which gets a copy-on-write snapshot of the edit buffer, the
+///            output pages, and the open files, and which then does all the
+///            work of copying the rest of the input to the output, closing
+///            the files, and renaming them. The parent process continues as
+///            though the EC command had completed.
+///
+///            Only one save can be active at a time; we wait for any previous
+///            save, and anything that opens a file also waits for completion.
+///
+///  @returns  true if save started, false if caller should save the files.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool start_save(void)
+{
+    struct ofile *ofile = &ofiles[ostream];
+
+    if (ofile->fp == NULL)
+    {
+        return false;                   // Let caller handle any error
+    }
+
+    (void)check_save(SAVE_WAIT);
+
+    int pipefd[2];
+
+    if (pipe(pipefd) == -1)
+    {
+        return false;                   // Do the save in the foreground
+    }
+
+    flush_term();
+    flush_log();
+    fflush(NULL);                       // Don't duplicate any buffered output
+
+    pid_t pid = fork();
+
+    if (pid == -1)
+    {
+        close(pipefd[0]);
+        close(pipefd[1]);
+
+        return false;                   // Do the save in the foreground
+    }
+
+    if (pid == 0)                       // Child process
+    {
+        int null = open("/dev/null", O_RDONLY);
+
+        if (null == -1
+            || dup2(null, STDIN_FILENO) == -1
+            || dup2(pipefd[1], STDOUT_FILENO) == -1
+            || dup2(pipefd[1], STDERR_FILENO) == -1)
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        close(null);
+        close(pipefd[0]);
+        close(pipefd[1]);
+
+        signal(SIGINT, SIG_IGN);        // CTRL/C is for the parent only
+
+        // Errors are printed to our pipe, and must not go to the terminal,
+        // the display, or the log file, and we must not run any exit
+        // handlers, since the parent still owns all of those.
+
+        f.e0.display = false;
+        f.e0.i_redir = true;
+        f.e0.o_redir = true;
+        f.et.abort   = false;
+
+        ofiles[OFILE_LOG].fp = NULL;
+
+        if (setjmp(jump_main) != 0)     // Here if error
+        {
+            flush_term();
+            fflush(stdout);
+
+            _exit(EXIT_FAILURE);
+        }
+
+        close_files();
+
+        flush_term();
+        fflush(stdout);
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(pipefd[1]);                   // Parent only reads from pipe
+
+    save.pid    = pid;
+    save.fd     = pipefd[0];
+    save.failed = false;
+    save.name   = alloc_mem((uint_t)strlen(ofile->name) + 1);
+
+    strcpy(save.name, ofile->name);
+
+    // Leave things as they would be after a foreground save, but without
+    // touching anything that the saver is now responsible for.
+
+    detach_file(ofile->fp);
+    detach_file(ifiles[istream].fp);
+
+    kill_edit();
+    reset_pages(ostream);
+    set_page(0);
+
+    close_output(ostream);
+    close_input(istream);
+
+    f.ctrl_e = false;
+
+    return true;
+}
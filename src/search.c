@@ -24,8 +24,15 @@
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
+#if     defined(__linux__)
+
+#define _GNU_SOURCE                     ///< For memrchr()
+
+#endif
+
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -43,18 +50,176 @@
 #include "search.h"
 #include "term.h"
 
+#define SKIP_MIN            3           ///< Min. length for skip table search
+
+#define TWOWAY_SPAN         (KB * 64)   ///< Min. text for Two-Way search
+
+#define MISS_MAX            32          ///< Max. spans in search cache
+
+#define MULTI_MAX           (MB * 16)   ///< Max. size of <CTRL/E>Mq automaton
+
+#if     INT_T == 64
+
+#define FORMAT_DEC          "%ld\n"     ///< Format for match positions
+
+#else
+
+#define FORMAT_DEC          "%d\n"      ///< Format for match positions
+
+#endif
+
+///  @struct  miss
+///  @brief   Span of edit buffer positions at which no match can start.
+
+struct miss
+{
+    int_t start;                        ///< First position in span
+    int_t end;                          ///< Last position in span, plus one
+};
+
 
 ///   @var    last_search
 ///   @brief  Last string searched for
 
 tstring last_search = { .len = 0 };
 
+///   @var    pat
+///   @brief  Compiled form of last search string. If the string contains no
+///           match control constructs, it can be found by scanning the edit
+///           buffer directly for one of its characters (the anchor), and then
+///           comparing the rest of the string, instead of calling match_str()
+///           at every position. Longer strings are searched forward with a
+///           skip table (Horspool), or with the Two-Way algorithm if they are
+///           repetitive enough that the skip table would not help much.
+
+static struct
+{
+    bool valid;                         ///< true if compiled from last_search
+    bool literal;                       ///< true if no match constructs
+    bool multi;                         ///< true if string is just ^EMq
+    bool qlocal;                        ///< true if local Q-register for ^EMq
+    int qname;                          ///< Q-register name for ^EMq
+    int ctrl_x;                         ///< CTRL/X flag when compiled
+    uint_t len;                         ///< Length of search string
+    uint_t anchor;                      ///< Index of anchor character
+    uint nchrs;                         ///< No. of chrs. matching anchor (or 0)
+    uchar chrs[2];                      ///< Characters matching anchor
+    uchar fold[UCHAR_MAX + 1];          ///< Folded value of each character
+    uint_t skip[UCHAR_MAX + 1];         ///< Horspool shift for each character
+    int_t crit;                         ///< Two-Way critical position
+    int_t period;                       ///< Two-Way shift after a match
+    bool periodic;                      ///< true if string has period above
+    uchar *data;                        ///< Folded search string
+} pat =
+{
+    .valid   = false,
+    .literal = false,
+    .data    = NULL,
+};
+
+///   @var    ac
+///   @brief  Aho-Corasick automaton for the lines in the Q-register used by a
+///           <CTRL/E>Mq search. Each state has a transition for each class
+///           of characters that occur in the lines (class 0 is for all other
+///           characters), and records the longest line that ends there.
+
+static struct
+{
+    int qindex;                         ///< Q-register index (or -1)
+    int ctrl_x;                         ///< CTRL/X flag when built
+    tstring text;                       ///< Copy of Q-register text
+    uint nclasses;                      ///< No. of character classes
+    uint nstates;                       ///< No. of states
+    uint_t maxlen;                      ///< Length of longest line
+    uint class[UCHAR_MAX + 1];          ///< Class of each character
+    uint *next;                         ///< Transitions for each state
+    uint_t *outlen;                     ///< Length of line ending in state
+    int_t *outline;                     ///< No. of line ending in state
+} ac =
+{
+    .qindex  = -1,
+    .text    = { .data = NULL, .len = 0 },
+    .next    = NULL,
+    .outlen  = NULL,
+    .outline = NULL,
+};
+
+///   @var    qclass
+///   @brief  Set of characters in each Q-register used by <CTRL/E>Gq, built
+///           at most once for each search.
+
+static struct
+{
+    uint_t serial;                      ///< Search no. when set was built
+    uchar bits[(UCHAR_MAX + 1) / CHAR_BIT]; ///< Bit set for each character
+} qclass[QCOUNT * 2];
+
+///   @var    cache
+///   @brief  Spans of the edit buffer that are known not to contain the start
+///           of any match for the last search string, so that repeating the
+///           search can skip over them. A hit is recorded as the end of the
+///           span that precedes it. The spans are kept only for literal strings
+///           and regular expressions, since whether they match at a position
+///           depends on a bounded range of text around it, so that any change
+///           to the buffer can be mapped onto the spans that it affects.
+
+static struct
+{
+    bool valid;                         ///< true if spans are for last_search
+    bool regex;                         ///< E1&2048 flag when spans were found
+    int ctrl_x;                         ///< CTRL/X flag when spans were found
+    int_t before;                       ///< Chrs. read before a position
+    int_t after;                        ///< Chrs. read from position (or -1)
+    uint nspans;                        ///< No. of spans
+    struct miss spans[MISS_MAX];        ///< Spans, in order of position
+} cache =
+{
+    .valid  = false,
+    .nspans = 0,
+};
+
+///   @var    search_serial
+///   @brief  No. of current search, used to check whether a <CTRL/E>Gq set is
+///           current. Q-registers can't change while we're searching.
+
+static uint_t search_serial = 0;
+
+///   @var    empty_pos
+///   @brief  Position of an empty match found by the last search (or -1), so
+///           that a new search starting there doesn't find it again.
+
+static int_t empty_pos = -1;
+
 // Local functions
 
+static void add_miss(int_t start, int_t end);
+
+static bool build_multi(void);
+
+static bool cache_backward(struct search *s, bool (*find)(struct search *s));
+
+static bool cache_forward(struct search *s, bool (*find)(struct search *s));
+
+static void check_cache(int_t before, int_t after);
+
+static void compile_search(void);
+
+static void copy_text(char *dst, int_t start, int_t end);
+
+static bool find_backward(struct search *s);
+
+static bool find_forward(struct search *s);
+
+static bool find_multi(struct search *s);
+
+static int get_qmatch(struct search *s);
+
 static int isblankx(int c, struct search *s);
 
 static int isctrlx(int c, int match);
 
+static int ismulti(int c, struct search *s);
+
 static int isqreg(int c, struct search *s);
 
 static int issymbol(int c);
@@ -63,6 +228,284 @@ static bool match_chr(int c, struct search *s);
 
 static bool match_str(struct search *s);
 
+static bool match_text(int_t pos);
+
+static int_t max_suffix(bool reverse, int_t *period);
+
+#if     !defined(__linux__)
+
+static void *memrchr(const void *s, int c, size_t n);
+
+#endif
+
+static bool next_line(const char *text, uint_t len, uint_t *pos,
+                      uint_t *start, uint_t *end);
+
+static int_t scan_anchor(const uchar *base, int_t first, int_t last);
+
+static int_t scan_horspool(const uchar *base, int_t first, int_t last);
+
+static int_t scan_twoway(const uchar *base, int_t first, int_t last);
+
+
+///
+///  @brief    Add span to the search cache, merging it with any spans that it
+///            overlaps or adjoins. If the cache is full, we discard whichever
+///            span at the ends of the cache is farther from the new one.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void add_miss(int_t start, int_t end)
+{
+    if (start < t->B)
+    {
+        start = t->B;
+    }
+
+    if (end > t->Z + 1)
+    {
+        end = t->Z + 1;                 // A match can start at Z
+    }
+
+    if (start >= end)
+    {
+        return;
+    }
+
+    struct miss *spans = cache.spans;
+    uint first = 0;
+
+    while (first < cache.nspans && spans[first].end < start)
+    {
+        ++first;
+    }
+
+    uint last = first;                  // First span after new one
+
+    while (last < cache.nspans && spans[last].start <= end)
+    {
+        if (start > spans[last].start)
+        {
+            start = spans[last].start;
+        }
+
+        if (end < spans[last].end)
+        {
+            end = spans[last].end;
+        }
+
+        ++last;
+    }
+
+    if (first == last)                  // Need room for new span?
+    {
+        if (cache.nspans == MISS_MAX)
+        {
+            if (first > MISS_MAX / 2)
+            {
+                memmove(&spans[0], &spans[1], sizeof(*spans) * (MISS_MAX - 1));
+
+                --first;
+            }
+
+            --cache.nspans;
+        }
+
+        memmove(&spans[first + 1], &spans[first],
+                sizeof(*spans) * (cache.nspans - first));
+
+        ++cache.nspans;
+    }
+    else if (last > first + 1)          // Merged two or more spans?
+    {
+        memmove(&spans[first + 1], &spans[last],
+                sizeof(*spans) * (cache.nspans - last));
+
+        cache.nspans -= last - first - 1;
+    }
+
+    spans[first].start = start;
+    spans[first].end   = end;
+}
+
+
+///
+///  @brief    Build the automaton for a <CTRL/E>Mq search, unless we already
+///            have one for the current contents of the Q-register and the
+///            current setting of the CTRL/X flag.
+///
+///  @returns  true if we have an automaton, false if it would be too large.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool build_multi(void)
+{
+    int qindex = get_qindex(pat.qname, pat.qlocal);
+
+    if (qindex == -1)
+    {
+        throw(E_IQN, pat.qname);        // Invalid Q-register name
+    }
+
+    const struct qreg *qreg = get_qreg(qindex);
+    uint_t len = qreg->text.len;
+
+    if (ac.qindex == qindex && ac.ctrl_x == f.ctrl_x && ac.text.len == len
+        && (len == 0 || memcmp(ac.text.data, qreg->text.data, len) == 0))
+    {
+        return (ac.next != NULL);
+    }
+
+    free_mem(&ac.text.data);
+    free_mem(&ac.next);
+    free_mem(&ac.outlen);
+    free_mem(&ac.outline);
+
+    ac.qindex   = qindex;
+    ac.ctrl_x   = f.ctrl_x;
+    ac.text.len = len;
+
+    if (len != 0)
+    {
+        ac.text.data = alloc_mem(len);
+
+        memcpy(ac.text.data, qreg->text.data, (size_t)len);
+    }
+
+    // Assign a class to each folded character used in the lines, so that we
+    // only need a transition for each class.
+
+    const uchar *text = (const uchar *)ac.text.data;
+    uint fclass[UCHAR_MAX + 1] = { 0 };
+    uint_t nchrs = 0;
+    uint_t pos = 0, start, end;
+
+    ac.nclasses = 1;
+    ac.maxlen   = 0;
+
+    while (next_line(ac.text.data, len, &pos, &start, &end))
+    {
+        for (uint_t i = start; i < end; ++i)
+        {
+            uchar fold = pat.fold[text[i]];
+
+            if (fclass[fold] == 0)
+            {
+                fclass[fold] = ac.nclasses++;
+            }
+        }
+
+        nchrs += end - start;
+
+        if (ac.maxlen < end - start)
+        {
+            ac.maxlen = end - start;
+        }
+    }
+
+    for (int c = 0; c <= UCHAR_MAX; ++c)
+    {
+        ac.class[c] = fclass[pat.fold[c]];
+    }
+
+    // Build a trie of the lines. State 0 is the root, so a transition of 0
+    // means that there is no child yet.
+
+    uint nclasses = ac.nclasses;
+    uint_t nstates = nchrs + 1;
+
+    // The transition table has an entry for each class in each state, so it
+    // can get very large. If so, leave the search to match_chr() instead.
+
+    if (nstates > MULTI_MAX / (nclasses * sizeof(*ac.next)))
+    {
+        return false;
+    }
+
+    ac.next    = alloc_mem(nstates * nclasses * (uint_t)sizeof(*ac.next));
+    ac.outlen  = alloc_mem(nstates * (uint_t)sizeof(*ac.outlen));
+    ac.outline = alloc_mem(nstates * (uint_t)sizeof(*ac.outline));
+    ac.nstates = 1;
+
+    int_t line = 0;
+
+    pos = 0;
+
+    while (next_line(ac.text.data, len, &pos, &start, &end))
+    {
+        uint state = 0;
+
+        ++line;
+
+        for (uint_t i = start; i < end; ++i)
+        {
+            uint *edge = &ac.next[state * nclasses + ac.class[text[i]]];
+
+            if (*edge == 0)
+            {
+                *edge = ac.nstates++;
+            }
+
+            state = *edge;
+        }
+
+        if (state != 0 && ac.outlen[state] == 0) // First of identical lines
+        {
+            ac.outlen[state]  = end - start;
+            ac.outline[state] = line;
+        }
+    }
+
+    // Go through the trie breadth-first, to set each missing transition to
+    // the one from the state for the longest proper suffix that's also in the
+    // trie, and to have each state record the longest line ending there.
+
+    uint *suffix = alloc_mem(ac.nstates * (uint_t)sizeof(*suffix));
+    uint *queue  = alloc_mem(ac.nstates * (uint_t)sizeof(*queue));
+    uint head = 0, tail = 0;
+
+    for (uint i = 1; i < nclasses; ++i)
+    {
+        if (ac.next[i] != 0)
+        {
+            queue[tail++] = ac.next[i]; // Suffix of root's children is root
+        }
+    }
+
+    while (head < tail)
+    {
+        uint state = queue[head++];
+        uint *row = &ac.next[state * nclasses];
+        const uint *from = &ac.next[suffix[state] * nclasses];
+
+        if (ac.outlen[state] == 0)
+        {
+            ac.outlen[state]  = ac.outlen[suffix[state]];
+            ac.outline[state] = ac.outline[suffix[state]];
+        }
+
+        for (uint i = 1; i < nclasses; ++i)
+        {
+            if (row[i] != 0)
+            {
+                suffix[row[i]] = from[i];
+                queue[tail++]  = row[i];
+            }
+            else
+            {
+                row[i] = from[i];
+            }
+        }
+    }
+
+    free_mem(&queue);
+    free_mem(&suffix);
+
+    return true;
+}
+
 
 ///
 ///  @brief    Build a search string, allocating storage for it.
@@ -77,330 +520,1737 @@ void build_search(const char *src, uint_t len)
 
     last_len = 0;                       // Assume search will fail
 
+    // If the string hasn't changed, as when a search is repeated in a loop,
+    // then keep its compiled form and the spans we know it doesn't match.
+
+    if (last_search.data != NULL && last_search.len == tmp.len
+        && memcmp(last_search.data, tmp.data, (size_t)tmp.len) == 0)
+    {
+        return;
+    }
+
     free_mem(&last_search.data);
 
     last_search.data = alloc_mem(tmp.len + 1);
     last_search.len = tmp.len;
 
     strcpy(last_search.data, tmp.data);
+
+    pat.valid = false;                  // Compile new string when needed
+    cache.valid = false;
+    cache.nspans = 0;
+
+    reset_regex();
 }
 
 
 ///
-///  @brief    Check for multiple blanks (spaces or tabs) at current position.
-///
-///            Note that we return 1/0 instead of true/false for compatibility
-///            with the ANSI isxxx() functions.
+///  @brief    Search backward, calling the search function only for the gaps
+///            between spans in the search cache, and then add the positions
+///            checked to the cache. This leaves the search block in the same
+///            state as the search function would have.
 ///
-///  @returns  1 if one or more blanks found, else 0.
+///  @returns  true if string found, else false.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static int isblankx(int c, struct search *s)
+static bool cache_backward(struct search *s, bool (*find)(struct search *s))
 {
     assert(s != NULL);                  // Error if no search block
-
-    if (!isblank(c))
-    {
-        return 0;
-    }
-
-    while (s->text_pos < s->text_end)
+    assert(find != NULL);               // Error if no search function
+
+    int_t dot      = t->dot;
+    int_t high     = s->text_start + dot; // First (highest) position to check
+    int_t low      = s->text_end + dot; // Last (lowest) position to check
+    int_t text_pos = s->text_start;
+    int_t text_end = s->text_end;
+    int_t pos      = high;
+    uint i         = cache.nspans;
+    bool found     = false;
+
+    while (!found && pos >= low)
     {
-        if ((c = read_edit(s->text_pos++)) == EOF)
+        while (i > 0 && cache.spans[i - 1].start > pos)
         {
-            break;
+            --i;
         }
-        else if (!isblank(c))
+
+        if (i > 0 && cache.spans[i - 1].end > pos)
         {
-            --s->text_pos;
+            pos = cache.spans[--i].start - 1; // Skip span we already checked
 
-            break;
+            continue;
+        }
+
+        int_t stop = low;               // Lowest position in this gap
+
+        if (i > 0 && cache.spans[i - 1].end > low)
+        {
+            stop = cache.spans[i - 1].end;
         }
+
+        s->text_start = pos - dot;
+        s->text_end   = stop - dot;
+
+        found = (*find)(s);
+        pos   = stop - 1;
     }
 
-    return 1;
+    s->text_end = text_end;
+
+    if (found)
+    {
+        add_miss(s->match_start + dot + 1, high + 1);
+    }
+    else
+    {
+        add_miss(low, high + 1);
+
+        s->text_start = (text_pos >= text_end) ? text_end - 1 : text_pos;
+    }
+
+    return found;
 }
 
 
 ///
-///  @brief    Check for case-insensitive match, depending on the setting of
-///            the CTRL/X flag:
-///
-///             1: Case-insensitive match.
-///
-///             0: Old case-insensitive match. Not only matches alphabetic
-///                characters, but additionally the following pairs.
-///
-///                @ (64) and ` (96)
-///                [ (91) and { (123)
-///                | (92) and \ (124)
-///                ] (93) and } (125)
-///                ^ (94) and ~ (126)
-///
-///            -1: Case-sensitive match.
-///
-///            Note that we return 1/0 instead of true/false for compatibility
-///            with the ANSI isxxx() functions.
+///  @brief    Search forward, calling the search function only for the gaps
+///            between spans in the search cache, and then add the positions
+///            checked to the cache. This leaves the search block in the same
+///            state as the search function would have.
 ///
-///  @returns  1 if a match found, else 0.
+///  @returns  true if string found, else false.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static int isctrlx(int c, int match)
+static bool cache_forward(struct search *s, bool (*find)(struct search *s))
 {
-    if (f.ctrl_x != -1)
+    assert(s != NULL);                  // Error if no search block
+    assert(find != NULL);               // Error if no search function
+
+    int_t dot      = t->dot;
+    int_t first    = s->text_start + dot; // First (lowest) position to check
+    int_t last     = s->text_end - 1 + dot; // Last (highest) position to check
+    int_t text_pos = s->text_start;
+    int_t text_end = s->text_end;
+    int_t pos      = first;
+    uint i         = 0;
+    bool found     = false;
+
+    if (s->type == SEARCH_C)            // ::S only checks first position
     {
-        c     = toupper(c);
-        match = toupper(match);
+        last = first;
+    }
 
-        if (!isalpha(c) && f.ctrl_x == 0)
+    while (!found && pos <= last)
+    {
+        while (i < cache.nspans && cache.spans[i].end <= pos)
         {
-            if (strchr("`{|}~", c) != NULL)
-            {
-                c -= 'a' - 'A';
-            }
+            ++i;
+        }
+
+        if (i < cache.nspans && cache.spans[i].start <= pos)
+        {
+            pos = cache.spans[i++].end; // Skip span we already checked
+
+            continue;
+        }
+
+        int_t stop = last;              // Highest position in this gap
+
+        if (i < cache.nspans && cache.spans[i].start <= last)
+        {
+            stop = cache.spans[i].start - 1;
+        }
+
+        s->text_start = pos - dot;
+        s->text_end   = stop + 1 - dot;
+
+        if (f.e1.trigram && find == find_forward)
+        {
+            found = index_search(s, find);
+        }
+        else
+        {
+            found = split_search(s, find);
+        }
+
+        pos = stop + 1;
+    }
+
+    s->text_end = text_end;
+
+    if (found)
+    {
+        add_miss(first, s->match_start + dot);
+    }
+    else
+    {
+        add_miss(first, last + 1);
+
+        if (text_pos >= text_end)
+        {
+            s->text_start = text_pos;
+        }
+        else if (s->type == SEARCH_C)
+        {
+            s->text_start = text_pos + 1;
+        }
+        else
+        {
+            s->text_start = text_end;
+        }
+    }
+
+    return found;
+}
+
+
+///
+///  @brief    Prepare search cache for the current search string, discarding
+///            any spans found for a different string or with different flags.
+///            A match at any position can depend on the before characters
+///            that precede it, and the after characters that start there.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void check_cache(int_t before, int_t after)
+{
+    if (!cache.valid || cache.ctrl_x != f.ctrl_x || cache.regex != f.e1.regex)
+    {
+        cache.valid  = true;
+        cache.regex  = f.e1.regex;
+        cache.ctrl_x = f.ctrl_x;
+        cache.nspans = 0;
+    }
+
+    cache.before = before;
+    cache.after  = after;
+}
+
+
+///
+///  @brief    Compile last search string, if it hasn't already been compiled
+///            for the current setting of the CTRL/X flag. Only strings with no
+///            match control constructs and no 8-bit characters are compiled;
+///            others are still matched by match_str(), except for a string
+///            that is just <CTRL/E>Mq, which is flagged for find_multi().
+///
+///            The folded value of each character is the same one that isctrlx()
+///            would compare, so two characters match if and only if they have
+///            the same folded value.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void compile_search(void)
+{
+    if (pat.valid && pat.ctrl_x == f.ctrl_x)
+    {
+        return;
+    }
+
+    pat.valid   = true;
+    pat.literal = false;
+    pat.multi   = false;
+    pat.ctrl_x  = f.ctrl_x;
+    pat.len     = last_search.len;
+
+    uint_t count[UCHAR_MAX + 1] = { 0 }; // No. of chrs. with each folded value
+
+    for (int c = 0; c <= UCHAR_MAX; ++c)
+    {
+        int fold = c;
+
+        if (f.ctrl_x != -1 && c != NUL)
+        {
+            fold = toupper(c);
+
+            if (f.ctrl_x == 0 && !isalpha(fold)
+                && strchr("`{|}~", fold) != NULL)
+            {
+                fold -= 'a' - 'A';
+            }
+        }
+
+        pat.fold[c] = (uchar)fold;
+
+        ++count[pat.fold[c]];
+    }
+
+    const char *p = last_search.data;
+
+    // A string that is just <CTRL/E>Mq can be found with an automaton built
+    // from the lines in Q-register q (see find_multi()).
+
+    if ((pat.len == 3 || (pat.len == 4 && p[2] == '.'))
+        && p[0] == CTRL_E && toupper(p[1]) == 'M')
+    {
+        pat.qlocal = (pat.len == 4);
+        pat.qname  = p[pat.len - 1];
+        pat.multi  = true;
+
+        return;
+    }
+
+    if (pat.len == 0)
+    {
+        return;
+    }
+
+    for (uint_t i = 0; i < pat.len; ++i)
+    {
+        int c = (uchar)p[i];
+
+        if (c > SCHAR_MAX || c == CTRL_E || c == CTRL_N || c == CTRL_S
+            || c == CTRL_X)
+        {
+            return;                     // Use match_str() for this string
+        }
+    }
+
+    free_mem(&pat.data);
+
+    pat.data = alloc_mem(pat.len);
+
+    for (uint_t i = 0; i < pat.len; ++i)
+    {
+        pat.data[i] = pat.fold[(uchar)last_search.data[i]];
+    }
+
+    // Use the last character that only matches itself as the anchor, since
+    // we can find it with a single library call. If there isn't one, use the
+    // last character, and scan for each character that it matches.
+
+    pat.anchor = pat.len - 1;
+
+    for (uint_t i = pat.len; i-- > 0; )
+    {
+        if (count[pat.data[i]] == 1)
+        {
+            pat.anchor = i;
+
+            break;
+        }
+    }
+
+    pat.nchrs = 0;
+
+    for (int c = 0; c <= UCHAR_MAX; ++c)
+    {
+        if (pat.fold[c] == pat.data[pat.anchor])
+        {
+            if (pat.nchrs == countof(pat.chrs))
+            {
+                pat.nchrs = 0;          // Too many, so check each character
+
+                break;
+            }
+
+            pat.chrs[pat.nchrs++] = (uchar)c;
+        }
+    }
+
+    // Set up the tables for searching forward with a skip table, or with the
+    // Two-Way algorithm, for strings that are long enough to benefit.
+
+    if (pat.len >= SKIP_MIN)
+    {
+        uint_t shift[UCHAR_MAX + 1];    // Shift for each folded value
+
+        for (int c = 0; c <= UCHAR_MAX; ++c)
+        {
+            shift[c] = pat.len;
+        }
+
+        for (uint_t i = 0; i < pat.len - 1; ++i)
+        {
+            shift[pat.data[i]] = pat.len - 1 - i;
+        }
+
+        for (int c = 0; c <= UCHAR_MAX; ++c)
+        {
+            pat.skip[c] = shift[pat.fold[c]];
+        }
+
+        int_t period1, period2;
+        int_t crit1 = max_suffix((bool)false, &period1);
+        int_t crit2 = max_suffix((bool)true, &period2);
+
+        if (crit1 > crit2)
+        {
+            pat.crit   = crit1;
+            pat.period = period1;
+        }
+        else
+        {
+            pat.crit   = crit2;
+            pat.period = period2;
+        }
+
+        pat.periodic = (memcmp(pat.data, pat.data + pat.period,
+                               (size_t)pat.crit + 1) == 0);
+
+        if (!pat.periodic)
+        {
+            int_t left  = pat.crit + 1;
+            int_t right = (int_t)pat.len - pat.crit - 1;
+
+            pat.period = (left > right ? left : right) + 1;
+        }
+    }
+
+    pat.literal = true;
+}
+
+
+///
+///  @brief    Copy text from the edit buffer, one block at a time.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void copy_text(char *dst, int_t start, int_t end)
+{
+    assert(dst != NULL || start == end);
+
+    while (start < end)
+    {
+        int_t low, high;
+        const char *base = block_edit(start, &low, &high);
+        int_t nbytes = (end < high ? end : high) - start;
+
+        memcpy(dst, base + start, (size_t)nbytes);
+
+        dst   += nbytes;
+        start += nbytes;
+    }
+}
+
+
+///
+///  @brief    Count all occurrences of the search string in a range, without
+///            moving dot. If a list is given, the start position of each match
+///            is appended to it, one per line. As with replace_all(), matches
+///            do not overlap, and an empty match (which only a regular
+///            expression can make) is followed by a search one character on.
+///
+///  @returns  No. of matches found.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int_t count_all(struct search *s, tbuffer *list)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    if (last_search.len == 0)
+    {
+        throw(E_SRH, "");               // Nothing to search for
+    }
+
+    int_t dot   = t->dot;
+    int_t count = 0;
+
+    while (search_forward(s))
+    {
+        if (list != NULL)
+        {
+            char num[32];
+            uint_t nbytes = (uint_t)snprintf(num, sizeof(num), FORMAT_DEC,
+                                             dot + s->match_start);
+
+            if (list->data == NULL)
+            {
+                *list = alloc_tbuf(KB);
+            }
+            else if (list->len + nbytes > list->size)
+            {
+                list->data  = expand_mem(list->data, list->size, list->size);
+                list->size += list->size;
+            }
+
+            memcpy(list->data + list->len, num, (size_t)nbytes);
+
+            list->len += nbytes;
+        }
+
+        s->text_start = (s->text_pos > s->match_start) ? s->text_pos
+                                                       : s->text_pos + 1;
+
+        ++count;
+    }
+
+    return count;
+}
+
+
+///
+///  @brief    Search backward for compiled search string, by scanning back for
+///            its anchor character and then checking the rest of the string.
+///            This checks the same positions as search_backward(), and leaves
+///            the search block in the same state.
+///
+///  @returns  true if string found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool find_backward(struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    int_t dot   = t->dot;
+    int_t first = s->text_start + dot;  // First (highest) position to check
+    int_t last  = s->text_end + dot;    // Last (lowest) position to check
+    int_t k     = (int_t)pat.anchor;
+
+    if (first > t->Z - (int_t)pat.len)
+    {
+        first = t->Z - (int_t)pat.len;  // String must fit in buffer
+    }
+
+    if (last < t->B)
+    {
+        last = t->B;
+    }
+
+    // Scan each block of the buffer in turn, from the position of the anchor
+    // character in the first string to check, back to that in the last one.
+
+    int_t pos = first + k;
+
+    while (pos >= last + k)
+    {
+        int_t start, end;
+        const uchar *base = (const uchar *)block_edit(pos, &start, &end);
+        int_t low = (start > last + k) ? start : last + k;
+        int_t found[countof(pat.chrs)] = { -2, -2 };
+
+        while (pos >= low)
+        {
+            int_t hit = -1;
+
+            if (pat.nchrs == 0)
+            {
+                while (pos >= low && pat.fold[base[pos]] != pat.data[k])
+                {
+                    --pos;
+                }
+
+                hit = (pos >= low) ? pos : -1;
+            }
+            else
+            {
+                // Find the nearest occurrence of each matching character,
+                // reusing any we found before that are still ahead of us.
+
+                for (uint i = 0; i < pat.nchrs; ++i)
+                {
+                    if (found[i] == -2 || found[i] > pos)
+                    {
+                        const uchar *p = memrchr(base + low, pat.chrs[i],
+                                                 (size_t)(pos - low + 1));
+
+                        found[i] = (p == NULL) ? -1 : p - base;
+                    }
+
+                    if (hit < found[i])
+                    {
+                        hit = found[i];
+                    }
+                }
+            }
+
+            if (hit == -1)
+            {
+                break;
+            }
+
+            pos = hit;
+
+            if (match_text(pos - k))
+            {
+                s->match_start = pos - k - dot;
+                s->text_start  = pos - k - 1 - dot;
+                s->text_pos   = pos - k + (int_t)pat.len - dot;
+
+                return true;
+            }
+
+            --pos;
+        }
+
+        pos = low - 1;                  // Continue with previous block
+    }
+
+    if (s->text_start >= s->text_end)
+    {
+        s->text_start = s->text_end - 1;
+    }
+
+    return false;
+}
+
+
+///
+///  @brief    Search forward for compiled search string. Each block of the
+///            buffer is scanned separately, and candidates that straddle the
+///            gap are checked one at a time. This checks the same positions as
+///            search_forward(), and leaves the search block in the same state.
+///
+///            The scanning method depends on the string and the amount of text
+///            to search. Short strings are found by scanning for their anchor
+///            character; longer ones use a skip table. But if the string is so
+///            repetitive that its last character recurs near the end, and there
+///            is a lot of text to search, we use the Two-Way algorithm instead,
+///            because its time is linear in the size of the text.
+///
+///  @returns  true if string found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool find_forward(struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    int_t dot   = t->dot;
+    int_t len   = (int_t)pat.len;
+    int_t first = s->text_start + dot;  // First (lowest) position to check
+    int_t last  = s->text_end - 1 + dot; // Last (highest) position to check
+
+    if (s->type == SEARCH_C)            // ::S only checks first position
+    {
+        last = first;
+    }
+
+    if (last > t->Z - len)
+    {
+        last = t->Z - len;              // String must fit in buffer
+    }
+
+    int_t pos = (first < t->B) ? t->B : first;
+    int_t (*scan)(const uchar *base, int_t first, int_t last) = scan_horspool;
+
+    if (pat.len < SKIP_MIN)
+    {
+        scan = scan_anchor;
+    }
+    else if (pat.skip[(uchar)last_search.data[len - 1]] * 4 < pat.len
+             && last - pos >= (int_t)TWOWAY_SPAN)
+    {
+        scan = scan_twoway;
+    }
+
+    while (pos <= last)
+    {
+        int_t start, end;
+        const uchar *base = (const uchar *)block_edit(pos, &start, &end);
+        int_t high = (end - len < last) ? end - len : last;
+        int_t hit = -1;
+
+        if (pos <= high)                // Scan strings wholly in this block
+        {
+            if ((hit = (*scan)(base, pos, high)) == -1)
+            {
+                pos = high + 1;
+            }
+        }
+
+        // Check any strings that start in this block and end in the next one.
+
+        while (hit == -1 && pos <= last && pos < end)
+        {
+            if (match_text(pos))
+            {
+                hit = pos;
+            }
+            else
+            {
+                ++pos;
+            }
+        }
+
+        if (hit != -1)
+        {
+            s->match_start = hit - dot;
+            s->text_pos    = hit + len - dot;
+
+            // See search_forward() for how movedot affects this.
+
+            s->text_start = (f.ed.movedot ? hit + 1 : hit + len) - dot;
+
+            return true;
+        }
+    }
+
+    if (s->text_start < s->text_end)
+    {
+        if (s->type == SEARCH_C)
+        {
+            ++s->text_start;
+        }
+        else
+        {
+            s->text_start = s->text_end;
+        }
+    }
+
+    return false;
+}
+
+
+///
+///  @brief    Search forward for any of the lines in the Q-register given by a
+///            <CTRL/E>Mq search string, using an Aho-Corasick automaton, so
+///            that each character is only examined once, however many lines
+///            there are. This finds the same string that match_str() would: the
+///            one that starts first, and of those, the one that comes first in
+///            the Q-register. The line number is stored in the Q-register.
+///
+///  @returns  true if string found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool find_multi(struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    int_t dot   = t->dot;
+    int_t first = s->text_start + dot;  // First (lowest) position to check
+    int_t last  = s->text_end - 1 + dot; // Last (highest) position to check
+
+    if (s->type == SEARCH_C)            // ::S only checks first position
+    {
+        last = first;
+    }
+
+    int_t pos   = (first < t->B) ? t->B : first;
+    int_t limit = last + (int_t)ac.maxlen; // End of text to scan
+    int_t best  = -1;                   // Start of best match so far
+    int_t line  = 0;                    // Line no. of best match
+    uint_t len  = 0;                    // Length of best match
+    uint state  = 0;
+
+    if (limit > t->Z)
+    {
+        limit = t->Z;
+    }
+
+    while (pos < limit)
+    {
+        int_t start, end;
+        const uchar *base = (const uchar *)block_edit(pos, &start, &end);
+        int_t high = (end < limit) ? end : limit;
+
+        while (pos < high)
+        {
+            state = ac.next[state * ac.nclasses + ac.class[base[pos++]]];
+
+            uint_t n = ac.outlen[state];
+
+            if (n != 0)
+            {
+                int_t match = pos - (int_t)n;
+
+                if (match <= last && (best == -1 || match < best
+                    || (match == best && ac.outline[state] < line)))
+                {
+                    best = match;
+                    line = ac.outline[state];
+                    len  = n;
+                }
+            }
+
+            // Once we're past the end of the longest line that could start
+            // at the best match, nothing else can start at or before it.
+
+            if (best != -1 && pos >= best + (int_t)ac.maxlen)
+            {
+                limit = pos;
+
+                break;
+            }
+        }
+    }
+
+    if (best != -1)
+    {
+        store_qnum(ac.qindex, line);
+
+        s->match_start = best - dot;
+        s->text_pos    = best + (int_t)len - dot;
+        s->text_start  = (f.ed.movedot ? best + 1 : best + (int_t)len) - dot;
+
+        return true;
+    }
+
+    if (s->text_start < s->text_end)
+    {
+        if (s->type == SEARCH_C)
+        {
+            ++s->text_start;
+        }
+        else
+        {
+            s->text_start = s->text_end;
+        }
+    }
+
+    return false;
+}
+
+
+///
+///  @brief    Get Q-register name following <CTRL/E>G or <CTRL/E>M in search
+///            string.
+///
+///  @returns  Q-register index.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int get_qmatch(struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    int qname;
+    bool qlocal = false;
+
+    if (s->match_len-- == 0)
+    {
+        throw(E_MQN);                   // Missing Q-register name
+    }
+
+    if ((qname = *s->match_buf++) == '.')
+    {
+        qlocal = true;
+
+        if (s->match_len-- == 0)
+        {
+            throw(E_MQN);               // Missing Q-register name
+        }
+
+        qname = *s->match_buf++;
+    }
+
+    int qindex = get_qindex(qname, qlocal);
+
+    if (qindex == -1)
+    {
+        throw(E_IQN, qname);            // Invalid Q-register name
+    }
+
+    return qindex;
+}
+
+
+///
+///  @brief    Check for multiple blanks (spaces or tabs) at current position.
+///
+///            Note that we return 1/0 instead of true/false for compatibility
+///            with the ANSI isxxx() functions.
+///
+///  @returns  1 if one or more blanks found, else 0.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int isblankx(int c, struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    if (!isblank(c))
+    {
+        return 0;
+    }
+
+    while (s->text_pos < s->text_end)
+    {
+        if ((c = read_edit(s->text_pos++)) == EOF)
+        {
+            break;
+        }
+        else if (!isblank(c))
+        {
+            --s->text_pos;
+
+            break;
+        }
+    }
+
+    return 1;
+}
+
+
+///
+///  @brief    Check for case-insensitive match, depending on the setting of
+///            the CTRL/X flag:
+///
+///             1: Case-insensitive match.
+///
+///             0: Old case-insensitive match. Not only matches alphabetic
+///                characters, but additionally the following pairs.
+///
+///                @ (64) and ` (96)
+///                [ (91) and { (123)
+///                | (92) and \ (124)
+///                ] (93) and } (125)
+///                ^ (94) and ~ (126)
+///
+///            -1: Case-sensitive match.
+///
+///            Note that we return 1/0 instead of true/false for compatibility
+///            with the ANSI isxxx() functions.
+///
+///  @returns  1 if a match found, else 0.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int isctrlx(int c, int match)
+{
+    if (f.ctrl_x != -1)
+    {
+        c     = toupper(c);
+        match = toupper(match);
+
+        if (!isalpha(c) && f.ctrl_x == 0)
+        {
+            if (strchr("`{|}~", c) != NULL)
+            {
+                c -= 'a' - 'A';
+            }
+
+            if (strchr("`{|}~", match) != NULL)
+            {
+                match -= 'a' - 'A';
+            }
+        }
+    }
+
+    return (c == match) ? 1 : 0;
+}
+
+
+///
+///  @brief    Check for a match with any of the lines in a Q-register. If one
+///            matches, the text position is moved past it, and the line number
+///            is stored in the Q-register.
+///
+///            Note that we return 1/0 instead of true/false for compatibility
+///            with the ANSI isxxx() functions.
+///
+///  @returns  1 if a match found, else 0.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int ismulti(int c, struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    int qindex = get_qmatch(s);
+    const struct qreg *qreg = get_qreg(qindex);
+    const uchar *text = (const uchar *)qreg->text.data;
+    uint_t pos = 0, start, end;
+    int_t line = 0;
+
+    while (next_line(qreg->text.data, qreg->text.len, &pos, &start, &end))
+    {
+        ++line;
+
+        if (start == end || !isctrlx(c, text[start]))
+        {
+            continue;
+        }
+
+        uint_t n = end - start;
+        uint_t i = 1;
+
+        while (i < n)
+        {
+            int next = read_edit(s->text_pos - 1 + (int_t)i);
+
+            if (next == EOF || !isctrlx(next, text[start + i]))
+            {
+                break;
+            }
+
+            ++i;
+        }
+
+        if (i == n)
+        {
+            s->text_pos += (int_t)n - 1;
+
+            store_qnum(qindex, line);
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+///
+///  @brief    Check for a match with one of the characters in a Q-register.
+///            The set of characters is only built once for each search.
+///
+///            Note that we return 1/0 instead of true/false for compatibility
+///            with the ANSI isxxx() functions.
+///
+///  @returns  1 if a match found, else 0.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int isqreg(int c, struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    int qindex = get_qmatch(s);
+    uchar *bits = qclass[qindex].bits;
+
+    if (qclass[qindex].serial != search_serial)
+    {
+        const struct qreg *qreg = get_qreg(qindex);
+
+        memset(bits, 0, sizeof(qclass[qindex].bits));
+
+        for (uint_t i = 0; i < qreg->text.len; ++i)
+        {
+            uchar chr = (uchar)qreg->text.data[i];
+
+            bits[chr / CHAR_BIT] |= (uchar)(1u << (chr % CHAR_BIT));
+        }
+
+        qclass[qindex].serial = search_serial;
+    }
+
+    return (bits[c / CHAR_BIT] >> (c % CHAR_BIT)) & 1;
+}
+
+
+///
+///  @brief    Check for a match on a symbol constituent: alphanumeric, period,
+///            dollar sign and underscore.
+///
+///            Note that we return 1/0 instead of true/false for compatibility
+///            with the ANSI isxxx() library functions.
+///
+///  @returns  1 if a match found, else 0.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int issymbol(int c)
+{
+    if (isalnum(c) || c == '.' || c == '$' || c == '_')
+    {
+        return 1;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+
+///
+///  @brief    Update the search cache for a change to the edit buffer, which
+///            replaced ndelete characters at pos with ninsert characters. We
+///            discard the parts of any spans where a match could now start, and
+///            shift those after the change. Any trigram index is discarded.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void mark_search(int_t pos, int_t ndelete, int_t ninsert)
+{
+    reset_index();
+
+    if (empty_pos != -1)
+    {
+        if (pos + ndelete < empty_pos || (ndelete == 0 && pos == empty_pos))
+        {
+            empty_pos += ninsert - ndelete; // Change was before match
+        }
+        else if (pos <= empty_pos)
+        {
+            empty_pos = -1;             // Change was around match
+        }
+    }
+
+    if (cache.nspans == 0)
+    {
+        return;
+    }
+
+    // Positions from low to high read text that has changed.
+
+    int_t low   = (cache.after == -1) ? t->B : pos - cache.after + 1;
+    int_t high  = pos + ndelete + cache.before;
+    int_t delta = ninsert - ndelete;
+    struct miss spans[MISS_MAX + 1];    // One span may be split in two
+    uint n = 0;
+
+    for (uint i = 0; i < cache.nspans; ++i)
+    {
+        struct miss span = cache.spans[i];
+
+        if (span.start < low)           // Keep part before change
+        {
+            spans[n].start = span.start;
+            spans[n].end   = (span.end < low) ? span.end : low;
+
+            ++n;
+        }
+
+        if (span.end > high)            // Keep part after change
+        {
+            spans[n].start = ((span.start > high) ? span.start : high) + delta;
+            spans[n].end   = span.end + delta;
+
+            ++n;
+        }
+    }
+
+    cache.nspans = (n > MISS_MAX) ? MISS_MAX : n;
+
+    memcpy(cache.spans, spans, sizeof(*spans) * cache.nspans);
+}
+
+
+///
+///  @brief    Check for a match on the current character in the edit buffer,
+///            allowing for the use of match control constructs in the search
+///            string. Note that we can be called recursively.
+///
+///  @returns  true if a match found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool match_chr(int c, struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    if (s->match_len-- == 0)
+    {
+        throw(E_ISS);                   // Invalid search string
+    }
+
+    int match = *s->match_buf++;
+
+    if (match == CTRL_E)
+    {
+        if (s->match_len-- == 0)
+        {
+            throw(E_ISS);               // Invalid search string
+        }
+
+        match = toupper(*s->match_buf++);
+
+        if ((match == 'A' && isalpha(c))     ||
+            (match == 'B' && !isalnum(c))    ||
+            (match == 'C' && issymbol(c))    ||
+            (match == 'D' && isdigit(c))     ||
+            (match == 'G' && isqreg(c, s))   ||
+            (match == 'L' && isdelim(c))     ||
+            (match == 'M' && ismulti(c, s))  ||
+            (match == 'R' && isalnum(c))     ||
+            (match == 'S' && isblankx(c, s)) ||
+            (match == 'V' && islower(c))     ||
+            (match == 'W' && isupper(c))     ||
+            (match == 'X'))
+        {
+            return true;
+        }
+        else if (strchr("ABCDGLMRSVWX", match) != NULL)
+        {
+            return false;               // Valid match chr., but no match
+        }
+
+        // <CTRL/E>nnn matches character whose decimal value is nnn.
+
+        if (match >= '0' && match <= '9')
+        {
+            int n = match - '0';
+
+            // Loop until we run out of decimal digits
+
+            while (s->match_len > 0)
+            {
+                if (!isdigit(*s->match_buf))
+                {
+                    break;
+                }
+
+                --s->match_len;
+
+                n *= 10;                // Shift digit over
+                n += *s->match_buf++ - '0'; // Add in new digit
+            }
+
+            return (c == n) ? true : false;
+        }
+
+        throw(E_ICE);                   // Invalid ^E command in search argument
+    }
+    else if (match == CTRL_N)           // ^N^N doesn't make sense
+    {
+        throw(E_ISS);                   // Invalid search string
+    }
+    else if ((match == CTRL_S && !isalnum(c)) ||
+             match == CTRL_X                  ||
+             isctrlx(c, match)                ||
+             c == match)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+
+///
+///  @brief    Check to see if text string matches search string.
+///
+///  @returns  true if match, else false (unless the first character is CTRL/N,
+///            if which case we return false if it's a match, otherwise true).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool match_str(struct search *s)
+{
+    assert(s != NULL);                  // Error if no search block
+
+    if (*s->match_buf == CTRL_N && s->match_len > 0)
+    {
+        --s->match_len;
+        ++s->match_buf;
+
+        while (s->match_len > 0)
+        {
+            int c = read_edit(s->text_pos++);
+
+            if (c == EOF)
+            {
+                return false;
+            }
+            else if (!match_chr(c, s))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+    else
+    {
+        while (s->match_len > 0)
+        {
+            int c = read_edit(s->text_pos++);
+
+            if (c == EOF || !match_chr(c, s))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+
+///
+///  @brief    Compare compiled search string with text at a buffer position.
+///            The caller must ensure that the string fits within the buffer.
+///
+///  @returns  true if match, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool match_text(int_t pos)
+{
+    int_t start, end;
+    const uchar *base = (const uchar *)block_edit(pos, &start, &end);
+
+    if (pos + (int_t)pat.len <= end)    // Is string all in one block?
+    {
+        base += pos;
+
+        for (uint_t i = 0; i < pat.len; ++i)
+        {
+            if (pat.fold[base[i]] != pat.data[i])
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        pos -= t->dot;
+
+        for (uint_t i = 0; i < pat.len; ++i)
+        {
+            if (pat.fold[(uchar)read_edit(pos + (int_t)i)] != pat.data[i])
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+///
+///  @brief    Find the maximal suffix of the compiled search string, using
+///            either the normal or the reverse ordering of characters. This is
+///            used to find the critical factorization for the Two-Way search.
+///
+///  @returns  Position before the start of the suffix (may be -1).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t max_suffix(bool reverse, int_t *period)
+{
+    assert(period != NULL);
+
+    const uchar *x = pat.data;
+    int_t len = (int_t)pat.len;
+    int_t pos = -1;
+    int_t j = 0;
+    int_t k = 1;
+    int_t p = 1;
+
+    while (j + k < len)
+    {
+        uchar a = x[j + k];
+        uchar b = x[pos + k];
+
+        if (reverse ? a > b : a < b)
+        {
+            j += k;
+            k = 1;
+            p = j - pos;
+        }
+        else if (a == b)
+        {
+            if (k != p)
+            {
+                ++k;
+            }
+            else
+            {
+                j += p;
+                k = 1;
+            }
+        }
+        else
+        {
+            pos = j++;
+            k = p = 1;
+        }
+    }
+
+    *period = p;
+
+    return pos;
+}
+
+
+#if     !defined(__linux__)
+
+///
+///  @brief    Find last occurrence of a character in memory, for systems whose
+///            C library doesn't include memrchr().
+///
+///  @returns  Pointer to character, or NULL if not found.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void *memrchr(const void *s, int c, size_t n)
+{
+    const uchar *p = (const uchar *)s + n;
+
+    while (p-- != s)
+    {
+        if (*p == (uchar)c)
+        {
+            return (void *)p;
+        }
+    }
+
+    return NULL;
+}
+
+#endif
+
+
+///
+///  @brief    Get the next line of text from a Q-register used by <CTRL/E>Mq.
+///            Lines are terminated by LF, and any CR before the LF is ignored.
+///
+///  @returns  true if line found, false if at end of text.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool next_line(const char *text, uint_t len, uint_t *pos,
+                      uint_t *start, uint_t *end)
+{
+    assert(pos != NULL);
+    assert(start != NULL);
+    assert(end != NULL);
+
+    if (*pos >= len)
+    {
+        return false;
+    }
 
-            if (strchr("`{|}~", match) != NULL)
-            {
-                match -= 'a' - 'A';
-            }
-        }
+    uint_t i = *start = *pos;
+
+    while (i < len && text[i] != LF)
+    {
+        ++i;
     }
 
-    return (c == match) ? 1 : 0;
+    *pos = i + 1;
+
+    if (i > *start && text[i - 1] == CR)
+    {
+        --i;
+    }
+
+    *end = i;
+
+    return true;
 }
 
 
 ///
-///  @brief    Check for a match with one of the characters in a Q-register.
+///  @brief    Replace all occurrences of the search string in the range set up
+///            in a search block for search_forward(). The new text for the
+///            range is built in a single pass, while the edit buffer is left
+///            unchanged, and then replaces the old text with one change. If
+///            this is a non-stop search, the rest of the file is processed one
+///            page at a time, as <FN...;> would do.
 ///
-///            Note that we return 1/0 instead of true/false for compatibility
-///            with the ANSI isxxx() functions.
+///            Each replacement deletes the text that was matched, and
+///            replacements don't overlap.
 ///
-///  @returns  1 if a match found, else 0.
+///  @returns  No. of replacements made.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static int isqreg(int c, struct search *s)
+int_t replace_all(struct search *s, const char *text, uint_t len)
 {
     assert(s != NULL);                  // Error if no search block
+    assert(text != NULL || len == 0);
 
-    int qname;
-    bool qlocal = false;
-
-    if (s->match_len-- == 0)
+    if (last_search.len == 0)
     {
-        throw(E_MQN);                   // Missing Q-register name
+        throw(E_SRH, "");               // Nothing to search for
     }
 
-    if ((qname = *s->match_buf++) == '.')
+    int_t count = 0;
+
+    for (;;)
     {
-        qlocal = true;
+        tbuffer buf = { .data = NULL, .size = 0, .len = 0, .pos = 0 };
+        int_t dot   = t->dot;
+        int_t first = -1;               // Start of first replacement
+        int_t next  = -1;               // End of last replacement
 
-        if (s->match_len-- == 0)
+        while (search_forward(s))
         {
-            throw(E_MQN);               // Missing Q-register name
+            int_t end   = dot + s->text_pos;
+            int_t start = dot + s->match_start;
+
+            if (first == -1)
+            {
+                first = next = start;
+            }
+
+            uint_t nbytes = (uint_t)(start - next) + len;
+
+            if (buf.data == NULL)
+            {
+                buf = alloc_tbuf(nbytes > KB ? nbytes : KB);
+            }
+            else if (buf.len + nbytes > buf.size)
+            {
+                uint_t delta = buf.size;
+
+                if (delta < nbytes)
+                {
+                    delta = nbytes;
+                }
+
+                buf.data  = expand_mem(buf.data, buf.size, delta);
+                buf.size += delta;
+            }
+
+            copy_text(buf.data + buf.len, next, start);
+
+            buf.len += (uint_t)(start - next);
+
+            if (len != 0)
+            {
+                memcpy(buf.data + buf.len, text, (size_t)len);
+
+                buf.len += len;
+            }
+
+            next = end;
+
+            // Continue after this match, or after the next character if the
+            // match was empty (which only a regular expression can be).
+
+            s->text_start = (end > start) ? s->text_pos : s->text_pos + 1;
+
+            ++count;
         }
 
-        qname = *s->match_buf++;
-    }
+        if (first != -1)
+        {
+            bool ok = replace_edit(first, next, buf.data, buf.len);
 
-    int qindex = get_qindex(qname, qlocal);
+            free_mem(&buf.data);
 
-    if (qindex == -1)
-    {
-        throw(E_IQN, qname);            // Invalid Q-register name
-    }
+            if (!ok)
+            {
+                throw(E_MEM);           // Memory overflow
+            }
+        }
 
-    struct qreg *qreg = get_qreg(qindex);
+        last_len = (first != -1) ? len : 0; // For FR command
 
-    for (uint_t i = 0; i < qreg->text.len; ++i)
-    {
-        if (c == qreg->text.data[i])
+        if (s->type != SEARCH_N)
         {
-            return 1;
+            break;
+        }
+
+        if (ofiles[ostream].fp == NULL)
+        {
+            throw(E_NFO);               // No file for output
+        }
+
+        if (!next_page((int_t)0, t->Z, f.ctrl_e, (bool)true))
+        {
+            break;
         }
+
+        s->text_start = 0;              // Start at current character
+        s->text_end   = t->Z;
     }
 
-    return 0;
+    return count;
 }
 
 
 ///
-///  @brief    Check for a match on a symbol constituent: alphanumeric, period,
-///            dollar sign and underscore.
-///
-///            Note that we return 1/0 instead of true/false for compatibility
-///            with the ANSI isxxx() library functions.
+///  @brief    Deallocate memory for last search.
 ///
-///  @returns  1 if a match found, else 0.
+///  @returns  Nothing.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static int issymbol(int c)
+void reset_search(void)
 {
-    if (isalnum(c) || c == '.' || c == '$' || c == '_')
-    {
-        return 1;
-    }
-    else
-    {
-        return 0;
-    }
+    free_mem(&last_search.data);
+    free_mem(&pat.data);
+    free_mem(&ac.text.data);
+    free_mem(&ac.next);
+    free_mem(&ac.outlen);
+    free_mem(&ac.outline);
+
+    reset_regex();
+    reset_index();
+
+    pat.valid = false;
+    cache.valid = false;
+    cache.nspans = 0;
+    ac.qindex = -1;
+    empty_pos = -1;
 }
 
 
 ///
-///  @brief    Check for a match on the current character in the edit buffer,
-///            allowing for the use of match control constructs in the search
-///            string. Note that we can be called recursively.
+///  @brief    Scan forward through one block of the buffer for the compiled
+///            search string, by finding its anchor character and then checking
+///            the rest of the string. The strings at positions first through
+///            last must all lie within the block.
 ///
-///  @returns  true if a match found, else false.
+///  @returns  Position of string, or -1 if not found.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static bool match_chr(int c, struct search *s)
+static int_t scan_anchor(const uchar *base, int_t first, int_t last)
 {
-    assert(s != NULL);                  // Error if no search block
-
-    if (s->match_len-- == 0)
-    {
-        throw(E_ISS);                   // Invalid search string
-    }
+    assert(base != NULL);
 
-    int match = *s->match_buf++;
+    int_t k = (int_t)pat.anchor;
+    int_t pos = first + k;
+    int_t high = last + k;
+    int_t found[countof(pat.chrs)] = { -2, -2 };
 
-    if (match == CTRL_E)
+    while (pos <= high)
     {
-        if (s->match_len-- == 0)
-        {
-            throw(E_ISS);               // Invalid search string
-        }
-
-        match = toupper(*s->match_buf++);
+        int_t hit = -1;
 
-        if ((match == 'A' && isalpha(c))     ||
-            (match == 'B' && !isalnum(c))    ||
-            (match == 'C' && issymbol(c))    ||
-            (match == 'D' && isdigit(c))     ||
-            (match == 'G' && isqreg(c, s))   ||
-            (match == 'L' && isdelim(c))     ||
-            (match == 'R' && isalnum(c))     ||
-            (match == 'S' && isblankx(c, s)) ||
-            (match == 'V' && islower(c))     ||
-            (match == 'W' && isupper(c))     ||
-            (match == 'X'))
+        if (pat.nchrs == 0)
         {
-            return true;
+            while (pos <= high && pat.fold[base[pos]] != pat.data[k])
+            {
+                ++pos;
+            }
+
+            hit = (pos <= high) ? pos : -1;
         }
-        else if (strchr("ABCDGLRSVWX", match) != NULL)
+        else
         {
-            return false;               // Valid match chr., but no match
-        }
-
-        // <CTRL/E>nnn matches character whose decimal value is nnn.
+            // Find the nearest occurrence of each matching character, reusing
+            // any we found before that are still ahead of us.
 
-        if (match >= '0' && match <= '9')
-        {
-            int n = match - '0';
+            for (uint i = 0; i < pat.nchrs; ++i)
+            {
+                if (found[i] != -1 && found[i] < pos)
+                {
+                    const uchar *p = memchr(base + pos, pat.chrs[i],
+                                            (size_t)(high - pos + 1));
 
-            // Loop until we run out of decimal digits
+                    found[i] = (p == NULL) ? -1 : p - base;
+                }
 
-            while (s->match_len > 0)
-            {
-                if (!isdigit(*s->match_buf))
+                if (found[i] != -1 && (hit == -1 || hit > found[i]))
                 {
-                    break;
+                    hit = found[i];
                 }
+            }
+        }
 
-                --s->match_len;
+        if (hit == -1)
+        {
+            break;
+        }
 
-                n *= 10;                // Shift digit over
-                n += *s->match_buf++ - '0'; // Add in new digit
-            }
+        pos = hit;
 
-            return (c == n) ? true : false;
+        if (match_text(pos - k))
+        {
+            return pos - k;
         }
 
-        throw(E_ICE);                   // Invalid ^E command in search argument
-    }
-    else if (match == CTRL_N)           // ^N^N doesn't make sense
-    {
-        throw(E_ISS);                   // Invalid search string
-    }
-    else if ((match == CTRL_S && !isalnum(c)) ||
-             match == CTRL_X                  ||
-             isctrlx(c, match)                ||
-             c == match)
-    {
-        return true;
+        ++pos;
     }
 
-    return false;
+    return -1;
 }
 
 
 ///
-///  @brief    Check to see if text string matches search string.
+///  @brief    Scan forward through one block of the buffer for the compiled
+///            search string, using the Horspool skip table: compare the last
+///            character first, and then shift by the distance from the end of
+///            the string to the previous occurrence of the text character
+///            that was aligned with it.
 ///
-///  @returns  true if match, else false (unless the first character is CTRL/N,
-///            if which case we return false if it's a match, otherwise true).
+///  @returns  Position of string, or -1 if not found.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-static bool match_str(struct search *s)
+static int_t scan_horspool(const uchar *base, int_t first, int_t last)
 {
-    assert(s != NULL);                  // Error if no search block
+    assert(base != NULL);
 
-    if (*s->match_buf == CTRL_N && s->match_len > 0)
+    uint_t end = pat.len - 1;
+    int_t pos  = first;
+
+    while (pos <= last)
     {
-        --s->match_len;
-        ++s->match_buf;
+        const uchar *text = base + pos;
 
-        while (s->match_len > 0)
+        if (pat.fold[text[end]] == pat.data[end])
         {
-            int c = read_edit(s->text_pos++);
+            uint_t i = 0;
 
-            if (c == EOF)
-            {
-                return false;
-            }
-            else if (!match_chr(c, s))
+            while (i < end && pat.fold[text[i]] == pat.data[i])
             {
-                return true;
+                ++i;
             }
-        }
-
-        return false;
-    }
-    else
-    {
-        while (s->match_len > 0)
-        {
-            int c = read_edit(s->text_pos++);
 
-            if (c == EOF || !match_chr(c, s))
+            if (i == end)
             {
-                return false;
+                return pos;
             }
         }
 
-        return true;
+        pos += (int_t)pat.skip[text[end]];
     }
+
+    return -1;
 }
 
 
 ///
-///  @brief    Deallocate memory for last search.
+///  @brief    Scan forward through one block of the buffer for the compiled
+///            search string, using the Two-Way algorithm: compare the string
+///            to the right of the critical position, then the part to the left
+///            of it, and shift by the period of the string after a match of
+///            the right part, so that no character is compared more than twice.
 ///
-///  @returns  Nothing.
+///  @returns  Position of string, or -1 if not found.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
-void reset_search(void)
+static int_t scan_twoway(const uchar *base, int_t first, int_t last)
 {
-    free_mem(&last_search.data);
+    assert(base != NULL);
+
+    int_t len    = (int_t)pat.len;
+    int_t crit   = pat.crit;
+    int_t memory = -1;                  // Prefix known to match (periodic)
+    int_t pos    = first;
+
+    while (pos <= last)
+    {
+        const uchar *text = base + pos;
+        int_t i = (crit > memory ? crit : memory) + 1;
+
+        while (i < len && pat.data[i] == pat.fold[text[i]])
+        {
+            ++i;
+        }
+
+        if (i < len)
+        {
+            pos += i - crit;
+            memory = -1;
+
+            continue;
+        }
+
+        i = crit;
+
+        while (i > memory && pat.data[i] == pat.fold[text[i]])
+        {
+            --i;
+        }
+
+        if (i <= memory)
+        {
+            return pos;
+        }
+
+        pos += pat.period;
+
+        if (pat.periodic)
+        {
+            memory = len - pat.period - 1;
+        }
+    }
+
+    return -1;
 }
 
 
@@ -417,6 +2267,28 @@ bool search_backward(struct search *s)
 {
     assert(s != NULL);                  // Error if no search block
 
+    if (f.e1.regex)
+    {
+        int_t maxlen = regex_length();
+
+        // A match also reads the characters on either side, for ^ and $.
+
+        check_cache((int_t)1, (maxlen == -1) ? -1 : maxlen + 1);
+
+        return cache_backward(s, regex_backward);
+    }
+
+    ++search_serial;
+
+    compile_search();
+
+    if (pat.literal)
+    {
+        check_cache((int_t)0, (int_t)pat.len);
+
+        return cache_backward(s, find_backward);
+    }
+
     // Start search at current position and see if we can get a match. If not,
     // decrement position by one, and try again. If we reach the end of the
     // edit buffer without a match, then return failure, otherwise update our
@@ -424,6 +2296,7 @@ bool search_backward(struct search *s)
 
     while (s->text_start >= s->text_end) // Search to beginning of buffer
     {
+        s->match_start = s->text_start;
         s->text_pos  = s->text_start--; // Start at current position
         s->match_len = last_search.len; // No. of characters left to match
         s->match_buf = last_search.data; // Start of match characters
@@ -495,6 +2368,40 @@ bool search_forward(struct search *s)
 {
     assert(s != NULL);                  // Error if no search block
 
+    if (f.e1.regex)
+    {
+        int_t maxlen = regex_length();
+
+        // A match also reads the characters on either side, for ^ and $.
+
+        check_cache((int_t)1, (maxlen == -1) ? -1 : maxlen + 1);
+
+        // If the last search found an empty match at dot, then start at the
+        // next character, so that repeating the search doesn't find it again.
+
+        if (s->type != SEARCH_C && s->text_start == 0 && t->dot == empty_pos)
+        {
+            ++s->text_start;
+        }
+
+        return cache_forward(s, regex_forward);
+    }
+
+    ++search_serial;
+
+    compile_search();
+
+    if (pat.literal)
+    {
+        check_cache((int_t)0, (int_t)pat.len);
+
+        return cache_forward(s, find_forward);
+    }
+    else if (pat.multi && build_multi())
+    {
+        return find_multi(s);
+    }
+
     // Start search at current position and see if we can get a match. If not,
     // increment position by one, and try again. If we reach the end of the
     // edit buffer without a match, then return failure, otherwise update our
@@ -502,6 +2409,7 @@ bool search_forward(struct search *s)
 
     while (s->text_start < s->text_end) // Search to end of buffer
     {
+        s->match_start = s->text_start;
         s->text_pos  = s->text_start++; // Start at current position
         s->match_len = last_search.len; // No. of characters left to match
         s->match_buf = last_search.data; // Start of match characters
@@ -647,9 +2555,11 @@ bool search_loop(struct search *s)
         }
     }
 
+    empty_pos = (s->text_pos == s->match_start) ? t->dot + s->text_pos : -1;
+
     set_dot(t->dot + s->text_pos);
 
-    last_len = last_search.len;         // Save length of last search string
+    last_len = (uint_t)(s->text_pos - s->match_start); // Save length of match
 
     return true;
 }
@@ -0,0 +1,376 @@
+///
+///  @file    search_sys.c
+///  @brief   System-dependent functions for searching large buffers with
+///           worker processes.
+///
+///  @copyright 2019-2022 Franklin P. Johnston / Nowwith Treble Software
+///
+///  Permission is hereby granted, free of charge, to any person obtaining a
+///  copy of this software and associated documentation files (the "Software"),
+///  to deal in the Software without restriction, including without limitation
+///  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///  and/or sell copies of the Software, and to permit persons to whom the
+///  Software is furnished to do so, subject to the following conditions:
+///
+///  The above copyright notice and this permission notice shall be included in
+///  all copies or substantial portions of the Software.
+///
+///  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIA-
+///  BILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///  THE SOFTWARE.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include "teco.h"
+#include "editbuf.h"
+#include "exec.h"
+#include "search.h"
+
+
+#define SPLIT_MIN       (MB * 64)       ///< Default min. positions to split
+
+#define SPLIT_HEAD      16              ///< Part of min. to search before split
+
+#define SPLIT_MAX       32              ///< Max. no. of worker processes
+
+///  @struct  worker
+///  @brief   State of a worker process searching part of the buffer.
+
+struct worker
+{
+    pid_t pid;                      ///< Process ID of worker (0 if none)
+    int fd;                         ///< Read end of worker's result pipe
+};
+
+///   @var    split_min
+///   @brief  Min. no. of positions for which a search is split (see -9EJ).
+
+static int_t split_min = (int_t)SPLIT_MIN;
+
+///   @var    split_max
+///   @brief  No. of worker processes, or 0 for one per CPU (see -10EJ).
+
+static uint split_max = 0;
+
+
+// Local functions
+
+static void finish_workers(struct worker *workers, uint nworkers);
+
+static bool start_worker(struct worker *worker, struct search *s,
+                         bool (*find)(struct search *s), int_t first,
+                         int_t last);
+
+
+///
+///  @brief    Stop any workers that are still running, and reap them all.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void finish_workers(struct worker *workers, uint nworkers)
+{
+    assert(workers != NULL);
+
+    for (uint i = 0; i < nworkers; ++i)
+    {
+        struct worker *worker = &workers[i];
+
+        if (worker->fd != -1)
+        {
+            close(worker->fd);
+
+            worker->fd = -1;
+        }
+
+        if (worker->pid != 0)
+        {
+            (void)kill(worker->pid, SIGKILL);
+
+            while (waitpid(worker->pid, NULL, 0) == -1 && errno == EINTR)
+            {
+                ;
+            }
+
+            worker->pid = 0;
+        }
+    }
+}
+
+
+///
+///  @brief    Search forward through a large range of positions by dividing
+///            it among worker processes. Each worker is a forked copy of TECO,
+///            and so has a copy-on-write snapshot of the edit buffer, which
+///            means that it can check the strings that start in its part of
+///            the range without any copying of text at the boundaries. Each
+///            worker returns just the position of the first match it finds,
+///            and the results are read in order, so the first match found is
+///            the earliest one, and any workers after it can be stopped.
+///
+///            We then call the search function for just the position of the
+///            match, so that the search block (and any Q-registers set by a
+///            regular expression) end up exactly as for a serial search.
+///
+///            Small ranges, and the first part of large ones, are searched
+///            serially, so that we only start workers if there is a lot of
+///            text without a match, rather than for every match of a string
+///            that occurs frequently.
+///
+///  @returns  true if string found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool split_search(struct search *s, bool (*find)(struct search *s))
+{
+    assert(s != NULL);                  // Error if no search block
+    assert(find != NULL);               // Error if no search function
+
+    int_t dot   = t->dot;
+    int_t first = s->text_start + dot;  // First (lowest) position to check
+    int_t last  = s->text_end - 1 + dot; // Last (highest) position to check
+
+    if (last > t->Z)
+    {
+        last = t->Z;
+    }
+
+    if (first < t->B)
+    {
+        first = t->B;
+    }
+
+    int_t head = split_min / SPLIT_HEAD; // Positions to search serially
+
+    if (s->type == SEARCH_C || last - first < split_min + head)
+    {
+        return (*find)(s);
+    }
+
+    int_t text_end = s->text_end;
+
+    s->text_end = first + head - dot;
+
+    bool found = (*find)(s);
+
+    s->text_end = text_end;
+
+    if (found)
+    {
+        return true;
+    }
+
+    first += head;
+
+    // We only ask how many CPUs there are once we know that we need them,
+    // since sysconf() reads a file each time it's called for this.
+
+    long ncpus = (split_max != 0) ? (long)split_max
+                                  : sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (ncpus < 2)
+    {
+        s->text_start = first - dot;
+
+        return (*find)(s);
+    }
+
+    uint nworkers = (ncpus > SPLIT_MAX) ? SPLIT_MAX : (uint)ncpus;
+    int_t chunk = (last - first) / (int_t)nworkers + 1;
+    struct worker workers[SPLIT_MAX];
+    uint nstarted = 0;
+
+    while (nstarted < nworkers)
+    {
+        int_t start = first + chunk * (int_t)nstarted;
+        int_t end   = (start + chunk - 1 < last) ? start + chunk - 1 : last;
+
+        if (start > last || !start_worker(&workers[nstarted], s, find,
+                                          start, end))
+        {
+            break;
+        }
+
+        ++nstarted;
+    }
+
+    int_t hit = -1;
+    bool failed = (nstarted == 0 || first + chunk * (int_t)nstarted <= last);
+
+    for (uint i = 0; !failed && hit == -1 && i < nstarted; ++i)
+    {
+        struct worker *worker = &workers[i];
+        ssize_t nbytes;
+
+        while ((nbytes = read(worker->fd, &hit, sizeof(hit))) == -1
+               && errno == EINTR)
+        {
+            ;
+        }
+
+        if (nbytes != (ssize_t)sizeof(hit))
+        {
+            failed = true;              // Worker died without a result
+            hit    = -1;
+        }
+    }
+
+    finish_workers(workers, nstarted);
+
+    if (failed)                         // Search serially if anything failed
+    {
+        s->text_start = first - dot;
+
+        return (*find)(s);
+    }
+    else if (hit == -1)
+    {
+        s->text_start = s->text_end;
+
+        return false;
+    }
+
+    s->text_start = hit - dot;
+    s->text_end   = hit + 1 - dot;
+
+    found = (*find)(s);
+
+    s->text_end = text_end;
+
+    assert(found);                      // Error if worker was wrong
+
+    return found;
+}
+
+
+///
+///  @brief    Get, and optionally set, the min. no. of positions for which a
+///            search is split among worker processes.
+///
+///  @returns  Min. no. of positions.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int split_size(int_t size)
+{
+    if (size >= 0)                      // Setting new value?
+    {
+        split_min = (size > INT_MAX) ? INT_MAX : size;
+    }
+
+    return (int)split_min;
+}
+
+
+///
+///  @brief    Get, and optionally set, the no. of worker processes used to
+///            split a search (0 means one per CPU).
+///
+///  @returns  No. of worker processes.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int split_workers(int_t n)
+{
+    if (n >= 0)                         // Setting new value?
+    {
+        split_max = (n > SPLIT_MAX) ? SPLIT_MAX : (uint)n;
+    }
+
+    return (int)split_max;
+}
+
+
+///
+///  @brief    Start worker process to search positions first through last. The
+///            worker writes the position of the first match, or -1, to a pipe.
+///
+///  @returns  true if worker started, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool start_worker(struct worker *worker, struct search *s,
+                         bool (*find)(struct search *s), int_t first,
+                         int_t last)
+{
+    assert(worker != NULL);
+    assert(s != NULL);
+    assert(find != NULL);
+
+    int pipefd[2];
+
+    worker->pid = 0;
+    worker->fd  = -1;
+
+    if (pipe(pipefd) == -1)
+    {
+        return false;
+    }
+
+    pid_t pid = fork();
+
+    if (pid == -1)
+    {
+        close(pipefd[0]);
+        close(pipefd[1]);
+
+        return false;
+    }
+
+    if (pid == 0)                       // Child process
+    {
+        close(pipefd[0]);
+
+        signal(SIGINT, SIG_IGN);        // CTRL/C is for the parent only
+
+        // Any error means that the parent gets no result, and must search
+        // this part of the buffer itself.
+
+        if (setjmp(jump_main) != 0)
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        int_t dot = t->dot;
+        int_t hit = -1;
+
+        s->text_start = first - dot;
+        s->text_end   = last + 1 - dot;
+
+        if ((*find)(s))
+        {
+            hit = s->match_start + dot;
+        }
+
+        if (write(pipefd[1], &hit, sizeof(hit)) != (ssize_t)sizeof(hit))
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(pipefd[1]);                   // Parent only reads from pipe
+
+    worker->pid = pid;
+    worker->fd  = pipefd[0];
+
+    return true;
+}
@@ -28,13 +28,16 @@
 #include <ctype.h>
 #include <ncurses.h>
 #include <stdio.h>
+#include <string.h>
 
 #define DISPLAY_INTERNAL            ///< Enable internal definitions
 
 #include "teco.h"
+#include "ascii.h"
 #include "display.h"
 #include "editbuf.h"
 #include "exec.h"
+#include "file.h"
 #include "page.h"
 #include "term.h"
 
@@ -54,6 +57,15 @@
 
 #define check_line(line, maxline) if (line == maxline) return;
 
+#define STATUS_MAX      16          ///< Max. no. of status lines we cache
+
+///  @var     status
+///
+///  @brief   Copies of the status lines last output, so that we only update
+///           those lines which have changed.
+
+static char status[STATUS_MAX][STATUS_WIDTH - 1];
+
 // Local functions
 
 static void print_status(int nrows);
@@ -179,6 +191,24 @@ static void print_status(int maxline)
     snprintf(buf, sizeof(buf), FMT " %s", memsize, memtype);
     status_line(line++, "memory", buf);
     check_line(line, maxline);
+
+    // Output state of any background save, or blank the line if there is
+    // none, so that a line left over from an earlier save is erased. This
+    // only peeks at the state, since reaping the saver could print to the
+    // terminal in the middle of a refresh.
+
+    int save = check_save(SAVE_PEEK);
+
+    if (save != 0)
+    {
+        status_line(line++, "save", (save > 0) ? "busy" : "failed");
+    }
+    else
+    {
+        status_line(line++, "", "");
+    }
+
+    check_line(line, maxline);
 }
 
 
@@ -239,6 +269,19 @@ void refresh_status(void)
 }
 
 
+///
+///  @brief    Reset status window, forcing all lines to be output again.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void reset_status(void)
+{
+    memset(status, NUL, sizeof(status));
+}
+
+
 ///
 ///  @brief    Update line in status window.
 ///
@@ -253,5 +296,16 @@ static void status_line(int line, const char *header, const char *data)
     int rem = (int)sizeof(buf) - nbytes;
 
     snprintf(buf + nbytes, (size_t)(uint)rem, "%*s ", rem - 1, data);
+
+    if (line < STATUS_MAX)
+    {
+        if (!strcmp(status[line], buf))
+        {
+            return;                     // Line hasn't changed
+        }
+
+        strcpy(status[line], buf);
+    }
+
     mvwprintw(d.status, line, 1, buf);
 }
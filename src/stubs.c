@@ -114,6 +114,28 @@ void exec_F4(struct cmd *unused)
 }
 
 
+///
+///  @brief    Execute F5 command: read syntax highlighting rules.
+///
+///  @returns  Returns failure for :F5 command, and 0 for nF5 command.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void exec_F5(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    if (cmd->n_set)
+    {
+        push_x((int_t)0, X_OPERAND);    // Nothing is highlighted
+    }
+    else if (cmd->colon)
+    {
+        push_x(FAILURE, X_OPERAND);     // Command failed
+    }
+}
+
+
 ///
 ///  @brief    Execute FM command: map key to command string, or unmap key.
 ///
@@ -176,6 +198,19 @@ void exit_dpy(void)
 }
 
 
+///
+///  @brief    Free memory used for syntax rules.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void exit_syntax(void)
+{
+    ;                                   // Nothing to do if no display
+}
+
+
 ///
 ///  @brief    Read next character without wait (non-blocking I/O).
 ///
@@ -240,6 +275,32 @@ void init_keys(void)
 }
 
 
+///
+///  @brief    Update column checkpoints after change to edit buffer.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void mark_column(int_t unused1, int_t unused2, int_t unused3)
+{
+    ;                                   // Nothing to do if no display
+}
+
+
+///
+///  @brief    Discard lexer checkpoints after change to edit buffer.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void mark_syntax(int_t unused)
+{
+    ;                                   // Nothing to do if no display
+}
+
+
 ///
 ///  @brief    Output character to command window.
 ///
@@ -318,6 +379,19 @@ void rubout_key(int unused)
 }
 
 
+///
+///  @brief    Select new active edit window.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void select_view(int view)
+{
+    w.view = view;                      // Just save it if no display
+}
+
+
 ///
 ///  @brief    Tell ncurses when 7-/8-bit setting changes.
 ///
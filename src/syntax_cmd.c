@@ -0,0 +1,998 @@
+///
+///  @file    syntax_cmd.c
+///  @brief   Execute F5 command, and syntax highlighting for edit window.
+///
+///  @copyright 2019-2022 Franklin P. Johnston / Nowwith Treble Software
+///
+///  Permission is hereby granted, free of charge, to any person obtaining a
+///  copy of this software and associated documentation files (the "Software"),
+///  to deal in the Software without restriction, including without limitation
+///  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///  and/or sell copies of the Software, and to permit persons to whom the
+///  Software is furnished to do so, subject to the following conditions:
+///
+///  The above copyright notice and this permission notice shall be included in
+///  all copies or substantial portions of the Software.
+///
+///  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIA-
+///  BILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///  THE SOFTWARE.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <ctype.h>
+#include <ncurses.h>
+#include <string.h>
+
+#define DISPLAY_INTERNAL            ///< Enable internal definitions
+
+#include "teco.h"
+#include "ascii.h"
+#include "display.h"
+#include "editbuf.h"
+#include "errcodes.h"
+#include "estack.h"
+#include "exec.h"
+#include "file.h"
+
+
+#define SYNTAX_STYLES   16                  ///< Max. no. of styles
+
+#define SYNTAX_SPANS    32                  ///< Max. no. of spans
+
+#define SYNTAX_WORD     64                  ///< Max. length of keyword
+
+#define SYNTAX_STEP     ((int_t)KB * 4)     ///< Distance between lexer checkpoints
+
+#define SYNTAX_SYNC     ((int_t)KB * 64)    ///< Max. distance lexed to find state
+
+#define SYNTAX_INIT     64                  ///< Initial no. of lexer checkpoints
+
+///  @struct  style
+///  @brief   Attributes used to highlight a class of text.
+
+struct style
+{
+    const char *name;               ///< Name of style
+    short color;                    ///< Foreground color (or -1)
+    attr_t attr;                    ///< Attributes (bold, underline, etc.)
+};
+
+///  @struct  span
+///  @brief   Text that starts and ends with specified strings, such as a
+///           comment or a quoted string. A span with no end string extends
+///           to the end of the line.
+
+struct span
+{
+    const char *start;              ///< Start string
+    const char *end;                ///< End string (may be empty)
+    uint_t startlen;                ///< Length of start string
+    uint_t endlen;                  ///< Length of end string
+    int esc;                        ///< Escape character (or EOF)
+    int style;                      ///< Style index
+};
+
+///  @struct  check
+///  @brief   Lexer state at the start of a line.
+
+struct check
+{
+    int_t pos;                      ///< Position of start of line
+    int state;                      ///< Lexer state at that position
+};
+
+///
+///  @var     syn
+///
+///  @brief   Syntax rules read by the last F5 command. Lexer states are 0
+///           for ordinary text, and n + 1 for text in span n. The text of the
+///           rules file is kept, and all strings in the rules point into it.
+///
+
+static struct
+{
+    tbuffer text;                   ///< Text of rules file
+    uint nstyles;                   ///< No. of styles
+    struct style styles[SYNTAX_STYLES]; ///< Styles
+    uint nspans;                    ///< No. of spans
+    struct span spans[SYNTAX_SPANS];    ///< Spans
+    int number;                     ///< Style for numbers (or -1)
+    const char **words;             ///< Hash table of keywords
+    uchar *wstyle;                  ///< Style for each keyword
+    uint_t nwords;                  ///< No. of keywords
+    uint_t size;                    ///< Size of hash table (power of 2)
+    bool first[UCHAR_MAX + 1];      ///< true if chr. may start a span
+} syn =
+{
+    .text    = { .size = 0, .pos = 0, .len = 0, .data = NULL },
+    .nstyles = 0,
+    .nspans  = 0,
+    .number  = -1,
+    .words   = NULL,
+    .wstyle  = NULL,
+    .nwords  = 0,
+    .size    = 0,
+};
+
+///
+///  @var     sc
+///
+///  @brief   Lexer state checkpoints, saved at the start of a line every
+///           SYNTAX_STEP characters or so, in order of position. Checkpoints
+///           following a change to the edit buffer are discarded.
+///
+
+static struct
+{
+    uint_t count;                   ///< No. of checkpoints saved
+    uint_t size;                    ///< No. of checkpoints allocated
+    struct check *checks;           ///< Checkpoints
+} sc =
+{
+    .count  = 0,
+    .size   = 0,
+    .checks = NULL,
+};
+
+// Local functions
+
+static void add_word(const char *word, int style);
+
+static int find_style(const char *name);
+
+static int get_style(int_t pos);
+
+static uint_t hash_word(const char *word, uint_t len);
+
+static int_t lex_span(int_t pos, int *state, int *style);
+
+static attr_t make_attr(int style);
+
+static bool match_text(int_t pos, const char *str, uint_t len);
+
+static int_t next_token(int_t pos, int *state, int *style);
+
+static char *next_word(char **line);
+
+static void parse_line(char *line);
+
+static void reset_syntax(void);
+
+
+///
+///  @brief    Add keyword to hash table.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void add_word(const char *word, int style)
+{
+    assert(word != NULL);
+
+    if ((syn.nwords + 1) * 2 > syn.size) // Keep table at most half full
+    {
+        uint_t size        = syn.size ? syn.size * 2 : 64;
+        const char **words = alloc_mem((uint_t)sizeof(*words) * size);
+        uchar *wstyle      = alloc_mem((uint_t)sizeof(*wstyle) * size);
+
+        for (uint_t i = 0; i < syn.size; ++i)
+        {
+            if (syn.words[i] != NULL)
+            {
+                uint_t j = hash_word(syn.words[i], (uint_t)strlen(syn.words[i]));
+
+                while (words[j &= size - 1] != NULL)
+                {
+                    ++j;
+                }
+
+                words[j]  = syn.words[i];
+                wstyle[j] = syn.wstyle[i];
+            }
+        }
+
+        free_mem(&syn.words);
+        free_mem(&syn.wstyle);
+
+        syn.words  = words;
+        syn.wstyle = wstyle;
+        syn.size   = size;
+    }
+
+    uint_t i = hash_word(word, (uint_t)strlen(word));
+
+    while (syn.words[i &= syn.size - 1] != NULL)
+    {
+        if (!strcmp(syn.words[i], word))
+        {
+            syn.wstyle[i] = (uchar)style; // Duplicate keyword
+
+            return;
+        }
+
+        ++i;
+    }
+
+    syn.words[i]  = word;
+    syn.wstyle[i] = (uchar)style;
+
+    ++syn.nwords;
+}
+
+
+///
+///  @brief    Set color pairs for syntax styles. The background for each pair
+///            is the same as that of the edit window, so this should be called
+///            whenever the edit window colors change.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void color_syntax(void)
+{
+    if (!f.e0.display)
+    {
+        return;
+    }
+
+    short fg, bg;
+
+    pair_content(EDIT, &fg, &bg);
+
+    for (uint i = 0; i < syn.nstyles; ++i)
+    {
+        short color = syn.styles[i].color;
+
+        init_pair((short)(SYNTAX + (int)i), color == -1 ? fg : color, bg);
+    }
+}
+
+
+///
+///  @brief    Execute F5 command: read syntax highlighting rules from file, or
+///            disable syntax highlighting if no file specified. nF5 returns
+///            the style used to highlight the character at position n.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void exec_F5(struct cmd *cmd)
+{
+    assert(cmd != NULL);
+
+    const char *name = cmd->text1.data;
+    uint_t len       = cmd->text1.len;
+    uint stream      = IFILE_QREGISTER;
+
+    if (cmd->n_set)                     // nF5 returns style at position n
+    {
+        int_t pos = cmd->n_arg;
+
+        if (pos < t->B || pos >= t->Z)
+        {
+            throw(E_POP, "F5");         // Pointer off page
+        }
+
+        push_x(d.syntax ? get_style(pos) + 1 : 0, X_OPERAND);
+
+        return;
+    }
+
+    reset_syntax();
+
+    if (len == 0)
+    {
+        if (cmd->colon)
+        {
+            push_x(SUCCESS, X_OPERAND);
+        }
+
+        return;
+    }
+
+    if ((name = init_filename(name, len, cmd->colon)) != NULL)
+    {
+        struct ifile *ifile;
+        uint_t size;
+
+        if ((ifile = open_command(name, stream, cmd->colon, &size)) != NULL)
+        {
+            syn.text.size = size;
+            syn.text.data = alloc_mem(size + 1);
+
+            read_command(ifile, stream, &syn.text);
+
+            syn.text.data[syn.text.len] = NUL;
+
+            char *line = syn.text.data;
+
+            while (line != NULL)
+            {
+                char *next = strchr(line, LF);
+
+                if (next != NULL)
+                {
+                    *next++ = NUL;
+                }
+
+                parse_line(line);
+
+                line = next;
+            }
+
+            d.syntax = true;
+
+            color_syntax();
+
+            f.e0.window = true;         // Repaint window with new rules
+
+            if (cmd->colon)
+            {
+                push_x(SUCCESS, X_OPERAND);
+            }
+
+            return;
+        }
+    }
+
+    if (cmd->colon)
+    {
+        push_x(FAILURE, X_OPERAND);
+    }
+}
+
+
+///
+///  @brief    Free memory used for syntax rules.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void exit_syntax(void)
+{
+    reset_syntax();
+
+    free_mem(&sc.checks);
+
+    sc.size = 0;
+}
+
+
+///
+///  @brief    Find style by name.
+///
+///  @returns  Style index (throws exception if not found).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int find_style(const char *name)
+{
+    if (name == NULL)
+    {
+        throw(E_RUL, "");               // Invalid syntax rule
+    }
+
+    for (uint i = 0; i < syn.nstyles; ++i)
+    {
+        if (!strcasecmp(name, syn.styles[i].name))
+        {
+            return (int)i;
+        }
+    }
+
+    throw(E_RUL, name);                 // Invalid syntax rule
+}
+
+
+///
+///  @brief    Get style used to highlight the character at a position, by
+///            lexing from the start of its line.
+///
+///  @returns  Style index, or -1 if character is not highlighted.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int get_style(int_t pos)
+{
+    int_t start = pos;
+
+    while (start > 0 && !isdelim(read_edit(start - 1 - t->dot)))
+    {
+        --start;
+    }
+
+    int state = get_syntax(start);
+    int style = -1;
+
+    while (start <= pos)
+    {
+        start = next_token(start, &state, &style);
+    }
+
+    return style;
+}
+
+
+///
+///  @brief    Get lexer state at start of line. This starts at the nearest
+///            checkpoint preceding the line, saving new checkpoints as it
+///            goes. If there isn't one within SYNTAX_SYNC characters, then we
+///            assume that the line following that point starts with ordinary
+///            text, so that the time needed is limited even for large files.
+///
+///  @returns  Lexer state.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int get_syntax(int_t pos)
+{
+    uint_t lo = 0;
+    uint_t hi = sc.count;
+
+    while (lo < hi)                     // Find first checkpoint after pos
+    {
+        uint_t mid = lo + (hi - lo) / 2;
+
+        if (sc.checks[mid].pos <= pos)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    int_t start = 0;
+    int state   = 0;
+    bool save   = (lo == sc.count);     // Only add checkpoints at end
+
+    if (lo != 0)
+    {
+        start = sc.checks[lo - 1].pos;
+        state = sc.checks[lo - 1].state;
+    }
+
+    if (pos - start > SYNTAX_SYNC)
+    {
+        int c;
+
+        start = pos - SYNTAX_SYNC;
+        state = 0;
+        save  = false;
+
+        while (start < pos && (c = read_edit(start++ - t->dot)) != EOF)
+        {
+            if (isdelim(c))
+            {
+                break;
+            }
+        }
+    }
+
+    int_t last = start;
+
+    while (start < pos)
+    {
+        start = lex_line(start, &state);
+
+        if (save && start - last >= SYNTAX_STEP && start <= pos)
+        {
+            if (sc.checks == NULL)
+            {
+                sc.size   = SYNTAX_INIT;
+                sc.checks = alloc_mem((uint_t)sizeof(*sc.checks) * sc.size);
+            }
+            else if (sc.count == sc.size)
+            {
+                uint_t size = (uint_t)sizeof(*sc.checks) * sc.size;
+
+                sc.checks = expand_mem(sc.checks, size, size);
+                sc.size  *= 2;
+            }
+
+            sc.checks[sc.count].pos   = start;
+            sc.checks[sc.count].state = state;
+
+            ++sc.count;
+
+            last = start;
+        }
+    }
+
+    return state;
+}
+
+
+///
+///  @brief    Hash keyword (FNV-1a).
+///
+///  @returns  Hash value.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static uint_t hash_word(const char *word, uint_t len)
+{
+    assert(word != NULL);
+
+    uint_t hash = 2166136261u;
+
+    for (uint_t i = 0; i < len; ++i)
+    {
+        hash ^= (uchar)word[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+///
+///  @brief    Lex remainder of line.
+///
+///  @returns  Position of start of next line (or Z).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int_t lex_line(int_t pos, int *state)
+{
+    assert(state != NULL);
+
+    attr_t attr;
+    int c;
+
+    while ((c = read_edit(pos - t->dot)) != EOF)
+    {
+        pos = lex_token(pos, state, &attr);
+
+        if (isdelim(c))
+        {
+            break;
+        }
+    }
+
+    return pos;
+}
+
+
+///
+///  @brief    Lex text within a span, up to and including the end string.
+///            Spans may continue onto following lines unless they have no end
+///            string, in which case they end with the line.
+///
+///  @returns  Position following text.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t lex_span(int_t pos, int *state, int *style)
+{
+    const struct span *span = &syn.spans[*state - 1];
+    int c;
+
+    *style = span->style;
+
+    while ((c = read_edit(pos - t->dot)) != EOF && !isdelim(c))
+    {
+        if (c == span->esc)
+        {
+            if ((c = read_edit(++pos - t->dot)) == EOF || isdelim(c))
+            {
+                break;
+            }
+        }
+        else if (span->endlen != 0 && match_text(pos, span->end, span->endlen))
+        {
+            *state = 0;
+
+            return pos + (int_t)span->endlen;
+        }
+
+        ++pos;
+    }
+
+    return pos;
+}
+
+
+///
+///  @brief    Lex next token in edit buffer, and get the attributes for the
+///            style used to highlight it.
+///
+///  @returns  Position following token.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int_t lex_token(int_t pos, int *state, attr_t *attr)
+{
+    assert(attr != NULL);
+
+    int style;
+
+    pos = next_token(pos, state, &style);
+
+    *attr = (style == -1) ? A_NORMAL : make_attr(style);
+
+    return pos;
+}
+
+
+///
+///  @brief    Make attributes for style.
+///
+///  @returns  Attributes.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static attr_t make_attr(int style)
+{
+    return (attr_t)COLOR_PAIR(SYNTAX + style) | syn.styles[style].attr;
+}
+
+
+///
+///  @brief    Discard lexer checkpoints following a change to the edit buffer
+///            at pos.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void mark_syntax(int_t pos)
+{
+    while (sc.count != 0 && sc.checks[sc.count - 1].pos > pos)
+    {
+        --sc.count;
+    }
+}
+
+
+///
+///  @brief    See if edit buffer matches string at specified position.
+///
+///  @returns  true if match, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool match_text(int_t pos, const char *str, uint_t len)
+{
+    for (uint_t i = 0; i < len; ++i)
+    {
+        if (read_edit(pos + (int_t)i - t->dot) != (uchar)str[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+///
+///  @brief    Lex next token in edit buffer. Tokens never extend past the end
+///            of a line, and line delimiters are always tokens by themselves.
+///
+///  @returns  Position following token.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static int_t next_token(int_t pos, int *state, int *style)
+{
+    assert(state != NULL);
+    assert(style != NULL);
+
+    int c = read_edit(pos - t->dot);
+
+    assert(c != EOF);
+
+    *style = -1;
+
+    if (isdelim(c))
+    {
+        if (*state != 0 && syn.spans[*state - 1].endlen == 0)
+        {
+            *state = 0;                 // Span ends with line
+        }
+
+        return pos + 1;
+    }
+    else if (*state != 0)
+    {
+        return lex_span(pos, state, style);
+    }
+
+    if (syn.first[c])
+    {
+        for (uint i = 0; i < syn.nspans; ++i)
+        {
+            const struct span *span = &syn.spans[i];
+
+            if (match_text(pos, span->start, span->startlen))
+            {
+                *state = (int)i + 1;
+
+                return lex_span(pos + (int_t)span->startlen, state, style);
+            }
+        }
+    }
+
+    if (isalpha(c) || c == '_')         // Identifier or keyword
+    {
+        char word[SYNTAX_WORD + 1];
+        uint_t len = 0;
+
+        do
+        {
+            if (len < SYNTAX_WORD)
+            {
+                word[len] = (char)c;
+            }
+
+            ++len;
+        } while ((c = read_edit(++pos - t->dot)) != EOF
+                 && (isalnum(c) || c == '_'));
+
+        if (len <= SYNTAX_WORD && syn.nwords != 0)
+        {
+            uint_t i = hash_word(word, len);
+
+            word[len] = NUL;
+
+            while (syn.words[i &= syn.size - 1] != NULL)
+            {
+                if (!strcmp(syn.words[i], word))
+                {
+                    *style = syn.wstyle[i];
+
+                    break;
+                }
+
+                ++i;
+            }
+        }
+
+        return pos;
+    }
+    else if (isdigit(c))                // Number
+    {
+        while ((c = read_edit(++pos - t->dot)) != EOF
+               && (isalnum(c) || c == '_' || c == '.'))
+        {
+            ;
+        }
+
+        *style = syn.number;
+
+        return pos;
+    }
+
+    // Anything else is ordinary text, up to the next character that might
+    // start something else.
+
+    while ((c = read_edit(++pos - t->dot)) != EOF && !isdelim(c)
+           && !isalnum(c) && c != '_' && !syn.first[c])
+    {
+        ;
+    }
+
+    return pos;
+}
+
+
+
+
+///
+///  @brief    Get next whitespace-delimited word in line.
+///
+///  @returns  Word, or NULL if no more words.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static char *next_word(char **line)
+{
+    assert(line != NULL);
+
+    char *p = *line;
+
+    while (isspace(*p))
+    {
+        ++p;
+    }
+
+    if (*p == NUL)
+    {
+        *line = p;
+
+        return NULL;
+    }
+
+    char *word = p;
+
+    while (*p != NUL && !isspace(*p))
+    {
+        ++p;
+    }
+
+    if (*p != NUL)
+    {
+        *p++ = NUL;
+    }
+
+    *line = p;
+
+    return word;
+}
+
+
+///
+///  @brief    Parse line from syntax rules file. Blank lines and lines that
+///            start with ! are ignored. Otherwise, each line has one of the
+///            following forms:
+///
+///            style name color [bold] [underline] [reverse]
+///            keyword style word...
+///            span style start end [escape]
+///            line style start
+///            number style
+///
+///  @returns  Nothing (throws exception if error).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void parse_line(char *line)
+{
+    assert(line != NULL);
+
+    char *rule = next_word(&line);
+
+    if (rule == NULL || *rule == '!')
+    {
+        return;
+    }
+    else if (!strcasecmp(rule, "style"))
+    {
+        char *name  = next_word(&line);
+        char *color = next_word(&line);
+
+        if (name == NULL || color == NULL)
+        {
+            throw(E_RUL, rule);         // Invalid syntax rule
+        }
+        else if (syn.nstyles == SYNTAX_STYLES)
+        {
+            throw(E_MAX);               // Internal program limit reached
+        }
+
+        struct style *style = &syn.styles[syn.nstyles];
+
+        style->name  = name;
+        style->color = -1;
+        style->attr  = A_NORMAL;
+
+        if (strcasecmp(color, "default") && (style->color = (short)find_color(color)) == -1)
+        {
+            throw(E_RUL, color);        // Invalid syntax rule
+        }
+
+        char *attr;
+
+        while ((attr = next_word(&line)) != NULL)
+        {
+            if (!strcasecmp(attr, "bold"))
+            {
+                style->attr |= A_BOLD;
+            }
+            else if (!strcasecmp(attr, "underline"))
+            {
+                style->attr |= A_UNDERLINE;
+            }
+            else if (!strcasecmp(attr, "reverse"))
+            {
+                style->attr |= A_REVERSE;
+            }
+            else
+            {
+                throw(E_RUL, attr);     // Invalid syntax rule
+            }
+        }
+
+        ++syn.nstyles;
+    }
+    else if (!strcasecmp(rule, "keyword"))
+    {
+        int style = find_style(next_word(&line));
+        char *word;
+
+        while ((word = next_word(&line)) != NULL)
+        {
+            add_word(word, style);
+        }
+    }
+    else if (!strcasecmp(rule, "span") || !strcasecmp(rule, "line"))
+    {
+        int style       = find_style(next_word(&line));
+        char *start     = next_word(&line);
+        const char *end = "";
+        char *esc       = NULL;
+
+        if (start == NULL)
+        {
+            throw(E_RUL, rule);         // Invalid syntax rule
+        }
+        else if (syn.nspans == SYNTAX_SPANS)
+        {
+            throw(E_MAX);               // Internal program limit reached
+        }
+        else if (tolower(*rule) == 's')
+        {
+            if ((end = next_word(&line)) == NULL)
+            {
+                throw(E_RUL, rule);     // Invalid syntax rule
+            }
+
+            esc = next_word(&line);
+        }
+
+        struct span *span = &syn.spans[syn.nspans++];
+
+        span->start    = start;
+        span->end      = end;
+        span->startlen = (uint_t)strlen(start);
+        span->endlen   = (uint_t)strlen(end);
+        span->esc      = (esc != NULL) ? (uchar)*esc : EOF;
+        span->style    = style;
+
+        syn.first[(uchar)*start] = true;
+    }
+    else if (!strcasecmp(rule, "number"))
+    {
+        syn.number = find_style(next_word(&line));
+    }
+    else
+    {
+        throw(E_RUL, rule);             // Invalid syntax rule
+    }
+}
+
+
+///
+///  @brief    Discard syntax rules and disable syntax highlighting.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void reset_syntax(void)
+{
+    if (d.syntax)
+    {
+        d.syntax = false;
+
+        f.e0.window = true;             // Repaint window without highlighting
+    }
+
+    free_mem(&syn.text.data);
+    free_mem(&syn.words);
+    free_mem(&syn.wstyle);
+
+    syn.text.size = syn.text.len = syn.text.pos = 0;
+    syn.nstyles   = 0;
+    syn.nspans    = 0;
+    syn.number    = -1;
+    syn.nwords    = 0;
+    syn.size      = 0;
+    sc.count      = 0;
+
+    memset(syn.first, 0, sizeof(syn.first));
+
+    mark_column((int_t)-1, (int_t)0, (int_t)0); // Discard saved lexer states
+}
@@ -197,6 +197,8 @@ int main(int argc, const char * const argv[])
         switch (setjmp(jump_main))
         {
             case MAIN_NORMAL:           // Normal entry
+                (void)check_save(SAVE_POLL); // Report finished saves
+
                 refresh_dpy();          // Update display if enabled
 
                 f.trace.flag = 0;       // Switch off all tracing bits
@@ -262,6 +264,8 @@ int main(int argc, const char * const argv[])
 
 static void exit_teco(void)
 {
+    flush_term();                       // Write any buffered output
+    flush_log();                        //  including any held for log file
     exit_dpy();                         // Disable display first (if active)
     exit_term();                        // Restore terminal settings next
     exit_files();                       // Close any open files
@@ -271,6 +275,7 @@ static void exit_teco(void)
     reset_search();                     // Deallocate memory for last search
 
     exit_map();                         // Deallocate memory for map commands
+    exit_syntax();                      // Deallocate memory for syntax rules
     exit_error();                       // Deallocate memory for errors
     exit_qreg();                        // Deallocate memory for Q-registers
     exit_edit();                        // Deallocate memory for edit buffer
@@ -55,6 +55,28 @@ enum
 
 static jmp_buf jump_first;              ///< longjmp() to reset terminal input
 
+#define AHEAD_SIZE      KB              ///< Size of typeahead buffer
+
+///
+///  @var     ahead
+///
+///  @brief   Typeahead buffer. Whenever we have to wait for input, we also
+///           read whatever else is already available (e.g., if the user has
+///           pasted a command string), so that it can be echoed and stored
+///           without flushing output or refreshing the screen for each key.
+///
+
+static struct
+{
+    uint_t pos;                         ///< Next character to return
+    uint_t len;                         ///< No. of characters in buffer
+    int data[AHEAD_SIZE];               ///< Characters read from terminal
+} ahead =
+{
+    .pos = 0,
+    .len = 0,
+};
+
 // Local functions
 
 static void exec_cancel(void);
@@ -67,11 +89,26 @@ static void exec_inspect(int_t pos, int_t line);
 
 static void exec_star(void);
 
+static void read_ahead(void);
+
 static int read_first(void);
 
 static int read_wait(void);
 
 
+///
+///  @brief    See if there is typeahead that we have not yet processed.
+///
+///  @returns  true if more input is available, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool check_typeahead(void)
+{
+    return (ahead.pos < ahead.len);
+}
+
+
 ///
 ///  @brief    Execute CTRL/U: delete to start of current line.
 ///
@@ -297,13 +334,33 @@ int getc_term(bool wait)
 
     int c;
 
-    if (wait)
+    if (ahead.pos < ahead.len)
     {
-        c = read_wait();
+        c = ahead.data[ahead.pos++];    // Use typeahead if we have any
     }
-    else if ((c = get_nowait()) == EOF)
+    else
     {
-        return EOF;
+        flush_term();                   // Make sure user sees all output
+
+        if (wait)
+        {
+            flush_log();                // Keep log current while we wait
+        }
+
+        ahead.pos = ahead.len = 0;
+
+        if (wait)
+        {
+            c = read_wait();
+        }
+        else if ((c = get_nowait()) == EOF)
+        {
+            return EOF;
+        }
+        else if (f.e0.display)
+        {
+            read_ahead();
+        }
     }
 
     // Here when we have a non-EOF character. See if it requires special
@@ -343,6 +400,25 @@ int getc_term(bool wait)
 }
 
 
+///
+///  @brief    Read any additional input that is available in display mode,
+///            without waiting for it.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void read_ahead(void)
+{
+    int c;
+
+    while (ahead.len < AHEAD_SIZE && (c = get_nowait()) != EOF)
+    {
+        ahead.data[ahead.len++] = c;
+    }
+}
+
+
 ///
 ///  @brief    Read command string from terminal or indirect command file.
 ///
@@ -710,13 +786,17 @@ static int read_wait(void)
 
         if (c != EOF)
         {
+            read_ahead();
+
             return c;
         }
     }
     else
     {
-        char chr;
-        ssize_t nbytes = read(fileno(stdin), &chr, sizeof(chr));
+        // Read as many characters as are available, not just the first one.
+
+        char chrs[AHEAD_SIZE + 1];
+        ssize_t nbytes = read(fileno(stdin), chrs, sizeof(chrs));
 
         if (nbytes == 0)                // EOF reading redirected stdin
         {
@@ -724,7 +804,12 @@ static int read_wait(void)
         }
         else if (nbytes != -1)          // Error?
         {
-            return chr;
+            for (ssize_t i = 1; i < nbytes; ++i)
+            {
+                ahead.data[ahead.len++] = chrs[i];
+            }
+
+            return chrs[0];
         }
     }
 
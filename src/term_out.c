@@ -29,6 +29,8 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "teco.h"
 #include "ascii.h"
@@ -66,10 +68,59 @@ const char *table_8bit[] =          ///< 8-bit characters
     "<o/>",  "<u`>",  "<u'>",  "<u^>",  "<u\">", "<y\">", "[FE]",  "[FF]",
 };
 
+#define TERM_BUF    (KB * 4)        ///< Size of terminal output buffer
+
+#define LOG_BUF     (KB * 64)       ///< Size of log file output buffer
+
+#define LOG_SECS    1               ///< Max. secs. log output is held
+
+///  @struct  obuf
+///
+///  @brief   Buffer for output to terminal or log file. Characters are saved
+///           here and written with a single call to fwrite(), either when the
+///           buffer fills, or when a complete span of output (such as the
+///           text typed by a T command) has been stored. Output to the log
+///           file is held longer, until the buffer fills or LOG_SECS have
+///           passed, or until something needs the log file to be current.
+
+struct obuf
+{
+    uint_t len;                     ///< No. of characters in buffer
+    uint_t size;                    ///< Size of buffer
+    time_t start;                   ///< Time first character was buffered
+    char *data;                     ///< Buffered characters
+};
+
+static char term_data[TERM_BUF];    ///< Characters for terminal
+
+static char log_data[LOG_BUF];      ///< Characters for log file
+
+static struct obuf out_term =       ///< Output to terminal
+{
+    .len   = 0,
+    .size  = TERM_BUF,
+    .start = 0,
+    .data  = term_data,
+};
+
+static struct obuf out_log =        ///< Output to log file
+{
+    .len   = 0,
+    .size  = LOG_BUF,
+    .start = 0,
+    .data  = log_data,
+};
+
 // Local functions
 
+static void flush_buf(struct obuf *buf, FILE *fp);
+
+static void put_buf(struct obuf *buf, FILE *fp, const char *text, uint_t len);
+
 static void tputc(int c, int input);
 
+static void type_chr(int c);
+
 
 ///
 ///  @brief    Echo input character.
@@ -163,6 +214,70 @@ void echo_in(int c)
     {
         tprint("%s", table_8bit[c & 0x7f]);
     }
+
+    if (!check_typeahead())             // Wait until typeahead is echoed
+    {
+        flush_term();
+    }
+}
+
+
+///
+///  @brief    Write buffered output to terminal and log file.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void flush_buf(struct obuf *buf, FILE *fp)
+{
+    assert(buf != NULL);
+
+    if (buf->len != 0)
+    {
+        if (fp != NULL)
+        {
+            fwrite(buf->data, 1uL, (size_t)buf->len, fp);
+        }
+
+        buf->len = 0;
+    }
+}
+
+
+///
+///  @brief    Flush all buffered output to log file. This must be called
+///            before anything else writes to the log file, before forking
+///            or exiting, and after an error, so that no output is lost.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void flush_log(void)
+{
+    flush_buf(&out_log, ofiles[OFILE_LOG].fp);
+}
+
+
+///
+///  @brief    Flush any buffered output to terminal, and any output to log
+///            file that has been held for long enough. This must be called
+///            before reading any input, and before anything else writes to
+///            stdout (including any child processes).
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void flush_term(void)
+{
+    flush_buf(&out_term, stdout);
+
+    if (out_log.len != 0 && time(NULL) - out_log.start >= LOG_SECS)
+    {
+        flush_log();
+    }
 }
 
 
@@ -259,13 +374,15 @@ void print_flag(int_t flag)
         }
         else if (c == LF && last != CR)
         {
-            type_out(CR);
+            type_chr(CR);
         }
 
-        type_out(c);
+        type_chr(c);
 
         last = c;
     }
+
+    flush_term();
 }
 
 
@@ -323,12 +440,58 @@ int tprint(
 
             tputc(buf[i], false);
         }
+
+        flush_term();
     }
 
     return nbytes;
 }
 
 
+///
+///  @brief    Store characters in output buffer, flushing it as it fills.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void put_buf(
+    struct obuf *buf,                   ///< Output buffer
+    FILE *fp,                           ///< Output stream
+    const char *text,                   ///< Characters to store
+    uint_t len)                         ///< No. of characters
+{
+    assert(buf != NULL);
+    assert(text != NULL);
+
+    while (len != 0)
+    {
+        if (buf->len == buf->size)
+        {
+            flush_buf(buf, fp);
+        }
+
+        if (buf->len == 0)
+        {
+            buf->start = time(NULL);
+        }
+
+        uint_t n = buf->size - buf->len;
+
+        if (n > len)
+        {
+            n = len;
+        }
+
+        memcpy(buf->data + buf->len, text, (size_t)n);
+
+        buf->len += n;
+        text     += n;
+        len      -= n;
+    }
+}
+
+
 ///
 ///  @brief    Output character to terminal or display. Note that ALL output is
 ///            done here, other than output specific to display mode, such as a
@@ -365,26 +528,120 @@ static void tputc(int c, int input)
 
     if (!f.et.truncate || term_pos < w.width)
     {
-        fputc(c, stdout);
+        char chr = (char)c;
+
+        put_buf(&out_term, stdout, &chr, 1);
 
         FILE *fp = ofiles[OFILE_LOG].fp;
 
         if (fp != NULL && ((input && !f.e3.noin) || (!input && !f.e3.noout)))
         {
-            fputc(c, fp);
+            put_buf(&out_log, fp, &chr, 1);
         }
     }
 }
 
 
 ///
-///  @brief    Type output character.
+///  @brief    Type output character. Output is flushed at the end of each line,
+///            so that text typed one character at a time (e.g., by ^A or =
+///            commands) appears as soon as it is complete.
 ///
 ///  @returns  Nothing.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
 void type_out(int c)
+{
+    type_chr(c);
+
+    if (c == NL || isdelim(c))
+    {
+        flush_term();
+    }
+}
+
+
+///
+///  @brief    Type span of text. Runs of printable characters that don't need
+///            any translation are copied directly to the output buffers, and
+///            the whole span is then flushed with a single write.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void type_text(const char *text, uint_t len)
+{
+    assert(text != NULL);
+
+    const char *end = text + len;
+
+    while (text < end)
+    {
+        const char *p = text;
+
+        if (f.eu == -1 && !f.e0.display)
+        {
+            while (p < end && *p >= SPACE && *p < DEL)
+            {
+                ++p;
+            }
+        }
+
+        if (p == text)
+        {
+            type_chr(*text++);
+
+            continue;
+        }
+
+        // Characters are only output if they will fit on the current line
+        // (when truncating), but the terminal position is always updated.
+
+        uint_t n = (uint_t)(p - text);
+        uint_t nout = n;
+
+        if (f.et.truncate)
+        {
+            int_t room = w.width - 1 - term_pos;
+
+            if (room < 0)
+            {
+                nout = 0;
+            }
+            else if ((uint_t)room < nout)
+            {
+                nout = (uint_t)room;
+            }
+        }
+
+        term_pos += (int)n;
+
+        put_buf(&out_term, stdout, text, nout);
+
+        FILE *fp = ofiles[OFILE_LOG].fp;
+
+        if (fp != NULL && !f.e3.noout)
+        {
+            put_buf(&out_log, fp, text, nout);
+        }
+
+        text = p;
+    }
+
+    flush_term();
+}
+
+
+///
+///  @brief    Type output character without flushing output.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void type_chr(int c)
 {
     if (c == NL)
     {
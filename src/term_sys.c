@@ -97,6 +97,9 @@ void detach_term(void)
 
 #if     defined(__linux) || defined(__win64) || defined(__APPLE__)
 
+    flush_term();
+    flush_log();
+
     pid_t pid = fork();                 // Create child process
 
     if (pid < 0)
@@ -0,0 +1,344 @@
+///
+///  @file    trigram.c
+///  @brief   Trigram index of edit buffer, used to find candidate positions
+///           for literal search strings.
+///
+///  @copyright 2019-2022 Franklin P. Johnston / Nowwith Treble Software
+///
+///  Permission is hereby granted, free of charge, to any person obtaining a
+///  copy of this software and associated documentation files (the "Software"),
+///  to deal in the Software without restriction, including without limitation
+///  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+///  and/or sell copies of the Software, and to permit persons to whom the
+///  Software is furnished to do so, subject to the following conditions:
+///
+///  The above copyright notice and this permission notice shall be included in
+///  all copies or substantial portions of the Software.
+///
+///  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIA-
+///  BILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///  THE SOFTWARE.
+///
+///  The edit buffer is divided into blocks, and for each block we keep a set
+///  of the trigrams (sequences of three characters) that start in it. Since a
+///  match for a literal string must contain each of the string's trigrams, a
+///  match can only start in a block if each of the trigrams is in that block
+///  or the next one, and only those blocks need be searched.
+///
+///  Trigrams are hashed, so each set is a bit set of fixed size, and the
+///  characters are folded so that the index is the same for any setting of
+///  the CTRL/X flag; both of these just mean that we search a few more blocks
+///  than we might otherwise have done.
+///
+///  The index is built when it is first needed, and discarded whenever the
+///  edit buffer changes, so it is only worth using for large buffers that are
+///  searched many times without being changed, such as files opened with -R.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "teco.h"
+#include "editbuf.h"
+#include "search.h"
+
+
+#define INDEX_BLOCK     (KB * 64)       ///< Characters in each block
+
+#define INDEX_BITS      16              ///< No. of bits in trigram hash
+
+#define INDEX_SET       ((1u << INDEX_BITS) / CHAR_BIT) ///< Bytes in each set
+
+#define INDEX_PROBES    32              ///< Max. trigrams checked for a string
+
+///   @var    idx
+///   @brief  Trigram index, with a bit set of trigram hashes for each block.
+
+static struct
+{
+    bool valid;                         ///< true if index is current
+    uchar *sets;                        ///< Bit sets for blocks
+    uint_t nblocks;                     ///< No. of blocks
+    uint_t size;                        ///< Memory used, in bytes
+    uint_t msecs;                       ///< Time to build, in milliseconds
+} idx =
+{
+    .valid = false,
+    .sets  = NULL,
+};
+
+
+// Local functions
+
+static void build_index(void);
+
+static bool check_block(uint_t block, const uint *hashes, uint nhashes);
+
+static inline uint fold_chr(int c);
+
+static inline uint hash_trigram(uint key);
+
+
+///
+///  @brief    Build trigram index for edit buffer, by setting the bit for each
+///            trigram in the set for the block in which it starts.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static void build_index(void)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    reset_index();
+
+    idx.nblocks = (uint_t)(t->Z - t->B) / INDEX_BLOCK + 1;
+    idx.size    = idx.nblocks * INDEX_SET;
+    idx.sets    = alloc_mem(idx.size);
+
+    uint key = 0;
+    int_t pos = t->B;
+
+    while (pos < t->Z)
+    {
+        int_t low, high;
+        const uchar *base = (const uchar *)block_edit(pos, &low, &high);
+
+        for (; pos < high; ++pos)
+        {
+            key = (key << CHAR_BIT) | fold_chr(base[pos]);
+
+            if (pos - t->B >= 2)        // Need three characters
+            {
+                uint h = hash_trigram(key);
+                uchar *set = idx.sets + (uint_t)(pos - 2 - t->B) / INDEX_BLOCK
+                                        * INDEX_SET;
+
+                set[h / CHAR_BIT] |= (uchar)(1u << (h % CHAR_BIT));
+            }
+        }
+    }
+
+    idx.valid = true;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    idx.msecs = (uint_t)((end.tv_sec - start.tv_sec) * 1000
+                         + (end.tv_nsec - start.tv_nsec) / 1000000);
+}
+
+
+///
+///  @brief    Check whether a match could start in a block, which requires that
+///            each trigram be in the block or the next one (for a match that
+///            extends into the next block).
+///
+///  @returns  true if match possible, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static bool check_block(uint_t block, const uint *hashes, uint nhashes)
+{
+    assert(hashes != NULL);
+
+    const uchar *set  = idx.sets + block * INDEX_SET;
+    const uchar *next = (block + 1 < idx.nblocks) ? set + INDEX_SET : NULL;
+
+    for (uint i = 0; i < nhashes; ++i)
+    {
+        uint byte = hashes[i] / CHAR_BIT;
+        uchar bit = (uchar)(1u << (hashes[i] % CHAR_BIT));
+
+        if ((set[byte] & bit) == 0 && (next == NULL || (next[byte] & bit) == 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+///
+///  @brief    Fold character for trigram index. This maps each character to
+///            a value that is the same for every character that it matches
+///            with any setting of the CTRL/X flag.
+///
+///  @returns  Folded character.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static inline uint fold_chr(int c)
+{
+    if (c >= '`' && c <= '~')
+    {
+        c -= 'a' - 'A';                 // Also maps `{|}~ to @[\]^
+    }
+
+    return (uint)c;
+}
+
+
+///
+///  @brief    Hash trigram.
+///
+///  @returns  Hash value.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+static inline uint hash_trigram(uint key)
+{
+    key &= (1u << (CHAR_BIT * 3)) - 1;
+
+    return (key * 2654435761u) >> (32 - INDEX_BITS);
+}
+
+
+///
+///  @brief    Search forward for literal search string, using trigram index to
+///            skip blocks that cannot contain the start of a match, and calling
+///            the search function for each run of other blocks in turn. This
+///            leaves the search block in the same state as the search function
+///            would.
+///
+///  @returns  true if string found, else false.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+bool index_search(struct search *s, bool (*find)(struct search *s))
+{
+    assert(s != NULL);                  // Error if no search block
+    assert(find != NULL);               // Error if no search function
+
+    int_t dot      = t->dot;
+    int_t first    = s->text_start + dot; // First (lowest) position to check
+    int_t last     = s->text_end - 1 + dot; // Last (highest) position to check
+    int_t text_end = s->text_end;
+    uint_t len     = last_search.len;
+
+    if (last > t->Z)
+    {
+        last = t->Z;
+    }
+
+    if (s->type == SEARCH_C || len < 3 || first < t->B || first > last)
+    {
+        return split_search(s, find);
+    }
+
+    if (!idx.valid)
+    {
+        build_index();
+    }
+
+    // Get the hashes of the trigrams in the string, but only for trigrams
+    // that start within a block of the string's start, so that any match
+    // that starts in a block has them in that block or the next one.
+
+    uint hashes[INDEX_PROBES];
+    uint nhashes = 0;
+    uint key = 0;
+
+    for (uint_t i = 0; i < len && i < INDEX_BLOCK + 1; ++i)
+    {
+        key = (key << CHAR_BIT) | fold_chr((uchar)last_search.data[i]);
+
+        if (i >= 2 && nhashes < INDEX_PROBES)
+        {
+            hashes[nhashes++] = hash_trigram(key);
+        }
+    }
+
+    uint_t block = (uint_t)(first - t->B) / INDEX_BLOCK;
+    uint_t end   = (uint_t)(last - t->B) / INDEX_BLOCK;
+    bool found   = false;
+
+    while (block <= end && !found)
+    {
+        if (!check_block(block, hashes, nhashes))
+        {
+            ++block;
+
+            continue;
+        }
+
+        int_t start = t->B + (int_t)(block * INDEX_BLOCK);
+
+        while (block <= end && check_block(block, hashes, nhashes))
+        {
+            ++block;
+        }
+
+        int_t stop = t->B + (int_t)(block * INDEX_BLOCK) - 1;
+
+        s->text_start = ((start < first) ? first : start) - dot;
+        s->text_end   = ((stop > last) ? last : stop) + 1 - dot;
+
+        found = split_search(s, find);
+    }
+
+    s->text_end = text_end;
+
+    if (!found)
+    {
+        s->text_start = text_end;
+    }
+
+    return found;
+}
+
+
+///
+///  @brief    Get the memory used by the trigram index.
+///
+///  @returns  No. of kilobytes (0 if no index).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int index_size(void)
+{
+    return idx.valid ? (int)((idx.size + KB - 1) / KB) : 0;
+}
+
+
+///
+///  @brief    Get the time taken to build the trigram index.
+///
+///  @returns  No. of milliseconds (0 if no index).
+///
+////////////////////////////////////////////////////////////////////////////////
+
+int index_time(void)
+{
+    return idx.valid ? (int)idx.msecs : 0;
+}
+
+
+///
+///  @brief    Discard trigram index.
+///
+///  @returns  Nothing.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+void reset_index(void)
+{
+    free_mem(&idx.sets);
+
+    idx.valid   = false;
+    idx.nblocks = 0;
+    idx.size    = 0;
+    idx.msecs   = 0;
+}
@@ -112,6 +112,8 @@ void exec_T(struct cmd *cmd)
 
 static void exec_type(int_t m, int_t n)
 {
+    char buf[KB * 4 + 1];               // Allow for CR before LF
+    uint_t len = 0;
     int last = EOF;
 
     for (int_t i = m; i < n; ++i)
@@ -124,13 +126,25 @@ static void exec_type(int_t m, int_t n)
         }
         else if (f.e3.CR_type && c == LF && last != CR)
         {
-            type_out(CR);
+            buf[len++] = CR;
         }
 
-        type_out(c);
+        buf[len++] = (char)c;
+
+        if (len >= sizeof(buf) - 1)
+        {
+            type_text(buf, len);
+
+            len = 0;
+        }
 
         last = c;
     }
+
+    if (len != 0)
+    {
+        type_text(buf, len);
+    }
 }
 
 
@@ -39,6 +39,7 @@
 #define DEFAULT_HEIGHT          24      ///< Default terminal rows
 #define DEFAULT_WIDTH           80      ///< Default terminal columns
 #define DEFAULT_MAXLINE        500      ///< Default maximum line length
+#define DEFAULT_REDRAW          33      ///< Default msecs. between repaints
 
 #define MIN_HEIGHT              10      ///< Minimum no. of rows
 #define MIN_WIDTH               10      ///< Minimum no. of columns
@@ -71,6 +72,9 @@ struct watch w =
     },
     .maxline  = DEFAULT_MAXLINE,        // 11:W
     .status   = 0,                      // 12:W
+    .redraw   = DEFAULT_REDRAW,         // 13:W
+    .nviews   = 1,                      // 14:W
+    .view     = 0,                      // 15:W
     .botdot   = 0,                      // FZ
 };
 
@@ -175,6 +179,15 @@ static int_t get_w(int_t n)
         case 12:                        // Width of status window (or 0 if none)
             return w.status;
 
+        case 13:                        // Min. time between repaints (msecs.)
+            return w.redraw;
+
+        case 14:                        // No. of edit windows
+            return w.nviews;
+
+        case 15:                        // Active edit window
+            return w.view + 1;
+
         default:
             throw(E_ARG);               // n:W is out of range
     }
@@ -396,6 +409,38 @@ static void set_w(int_t m, int_t n)
 
             break;
 
+        case 13:
+            if (m >= 0)
+            {
+                w.redraw = (int)m;
+            }
+
+            break;
+
+        case 14:
+            if (m >= 1 && m <= VIEW_MAX && w.nviews != (int)m)
+            {
+                if (w.view >= (int)m)
+                {
+                    select_view((int)m - 1);
+                }
+
+                w.nviews = (int)m;
+
+                reset_dpy((bool)true);
+            }
+
+            break;
+
+        case 15:
+            if (m >= 1 && m <= w.nviews && w.view != (int)m - 1)
+            {
+                select_view((int)m - 1);
+                refresh_dpy();
+            }
+
+            break;
+
         default:
             throw(E_ARG);               // m,n:W is out of range
     }